@@ -4,23 +4,53 @@
 #include <string.h>
 #include <stdbool.h>
 #include <ctype.h> 
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <dirent.h>
+#include <limits.h>
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
 
 #define MAX_INPUT_LENGTH 1024
-#define MAX_NAME_LENGTH 32
 #define MAX_TOKENS 256
 #define MAX_ITEMS 20
 #define MAX_SUBJECTS 20
 #define MAX_LOCATIONS 20
+#define MAX_ITEM_TYPES (MAX_SUBJECTS * MAX_ITEMS)
+#define QUANTITY_MAX (LLONG_MAX / MAX_SUBJECTS) // quantities stay below this, so the total of an item over all subjects fits in a long long
+#define CACHE_SIZE 256 // number of cached answers, must be a power of two
+#define CACHE_MAX_SUBJECTS 8 // "total" questions with more subjects than this are not cached
+#define IMPORT_BLOCK_SIZE (1 << 20) // number of bytes read from an import file at once
+#define NAME_CHUNK_BITS 20 // a name id is (chunk << NAME_CHUNK_BITS) | offset in chunk
+#define NAME_CHUNK_SIZE (1u << NAME_CHUNK_BITS)
+#define MAX_NAME_LENGTH (NAME_CHUNK_SIZE - sizeof(unsigned int) - 1) // a name, its length and its '\0' fit in one chunk of the name pool
+#define KEYFRAME_INTERVAL 1024 // number of commands between two full copies of the world in the history
+#define INPUT_CHUNK_SIZE (1 << 16) // number of bytes read from the standard input at once
+#define OUTPUT_FLUSH_SIZE (1 << 16) // output is written when this many bytes are collected, or before waiting for input
 
 
 
 bool is_numeric_string(char *str);
+long long parse_number(const char *str, long long max);
 bool is_valid_word(char *str);
 
-int get_subject_item_quantity(char* subject_name, char* item_name);
+long long get_subject_item_quantity(char* subject_name, char* item_name);
 int print_all_items(char* name);
 int print_location(char* name);
 int print_people_at(char* location_name);
+int print_most_holders(char* item_name);
+int print_top_holders(int count, char* item_name);
+int print_world_total(char* item_name);
+int print_holders_compared(char* item_name, bool more, long long comparison_quantity);
+int print_memory();
 
 bool contains_keyword(char **tokens, int *token_count);
 int get_actionword_index(char **tokens, int token_count, int start_index);
@@ -41,20 +71,514 @@ int answer_question(char **tokens, int token_count);
 
 void free_tokens(char **tokens, int token_count);
 
+int import_file(char *path);
+int export_file(char *path);
+
+typedef struct World World;
+typedef struct History History;
+History* create_history();
+void free_history(History *history);
+void record_history(World *previous, World *next);
+int answer_question_at(char **tokens, int token_count, long long time);
+bool run_command(char *input);
+bool execute_line(char *input);
+void clear_answer_cache();
+void free_past_world();
+
+long long now_ns();
+FILE* start_recording(char *path);
+void record_command(FILE *record, char *line, long long start_time, long long latency, size_t answer_start);
+int replay_log(char *path);
+int run_tests(char *directory, int thread_count, int reader_count);
+void trace_begin(const char *name);
+void trace_end(const char *name);
+
 
 //
 // 1. Useful functions that are non-related to project
 //
 
-// Function to check whether a string is a number
-bool is_numeric_string(char *str) {
-    while (*str) {
-        if (!isdigit(*str)) {
-            return false; // Not a digit
+// Memory used by the program is counted per subsystem, with the highest value each counter reached
+// the counters are for the whole process, all stores and threads together, not for one world
+#define MEMORY_SUBJECTS 0 // subjects of all versions of the world
+#define MEMORY_ITEMS 1 // quantity columns of item types
+#define MEMORY_LOCATIONS 2 // locations of all versions of the world
+#define MEMORY_NAMES 3 // chunks of the name pool
+#define MEMORY_INDEXES 4 // name table, heaps and item type lists
+#define MEMORY_CACHES 5 // cached answers
+#define MEMORY_HISTORY 6 // deltas, keyframes and rebuilt past worlds
+#define MEMORY_BUFFERS 7 // output and trace buffers
+#define MEMORY_KINDS 8
+char *memory_kind_names[MEMORY_KINDS] = {"subjects", "items", "locations", "names", "indexes", "caches", "history", "buffers"};
+_Atomic long long memory_used[MEMORY_KINDS + 1]; // the last one is the total
+_Atomic long long memory_peak[MEMORY_KINDS + 1];
+bool print_memory_counters = true; // the test runner turns this off, the counters change with the cases that run in parallel
+
+// Function to raise a peak to a value if it is lower
+void raise_peak(_Atomic long long *peak, long long value) {
+    long long old_peak = atomic_load(peak);
+    while (old_peak < value && !atomic_compare_exchange_weak(peak, &old_peak, value)) {
+    }
+}
+
+// Function to count bytes allocated (or freed, if bytes is negative) by a subsystem
+void count_memory(int kind, long long bytes) {
+    raise_peak(&memory_peak[kind], atomic_fetch_add(&memory_used[kind], bytes) + bytes);
+    raise_peak(&memory_peak[MEMORY_KINDS], atomic_fetch_add(&memory_used[MEMORY_KINDS], bytes) + bytes);
+}
+
+// Output of the program is collected in a buffer and written to stdout once per command, every thread has its own buffer
+_Thread_local char *output_buffer = NULL;
+_Thread_local size_t output_size = 0;
+_Thread_local size_t output_capacity = 0;
+
+// Function to make sure there is space for length more bytes (and a '\0') in the output buffer
+void reserve_output(size_t length) {
+    if (output_size + length + 1 > output_capacity) {
+        size_t old_capacity = output_capacity;
+        while (output_size + length + 1 > output_capacity) {
+            output_capacity = output_capacity == 0 ? 4096 : output_capacity * 2;
+        }
+        output_buffer = realloc(output_buffer, output_capacity);
+        count_memory(MEMORY_BUFFERS, output_capacity - old_capacity);
+    }
+}
+
+// Function to add text to the output buffer
+void out_append(const char *text, size_t length) {
+    reserve_output(length);
+    memcpy(output_buffer + output_size, text, length);
+    output_size += length;
+}
+
+// Function to add a '\0' terminated text to the output buffer
+void out_string(const char *text) {
+    out_append(text, strlen(text));
+}
+
+// the numbers 00 to 99 as pairs of digits, numbers are converted two digits at a time
+const char digit_pairs[201] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+// Function to add a number to the output buffer, this is the "%lld" of out_printf without parsing a format
+void out_number(long long value) {
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    char *start = end;
+    unsigned long long number = value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+    // write the digits from the end, two at a time
+    while (number >= 100) {
+        start -= 2;
+        memcpy(start, digit_pairs + (number % 100) * 2, 2);
+        number /= 100;
+    }
+    if (number >= 10) {
+        start -= 2;
+        memcpy(start, digit_pairs + number * 2, 2);
+    } else {
+        *--start = '0' + number;
+    }
+    if (value < 0) {
+        *--start = '-';
+    }
+    out_append(start, end - start);
+}
+
+// Function to free the output buffer of the thread, before the thread exits
+void free_output() {
+    count_memory(MEMORY_BUFFERS, -(long long)output_capacity);
+    free(output_buffer);
+    output_buffer = NULL;
+    output_size = 0;
+    output_capacity = 0;
+}
+
+// Function to add formatted text to the output buffer, works like printf (answers use out_append, out_number and out_name, this is for reports)
+void out_printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    reserve_output(length);
+    va_start(args, format);
+    vsnprintf(output_buffer + output_size, length + 1, format, args);
+    va_end(args);
+    output_size += length;
+}
+
+// With --trace, the begin and end of the steps of every command are recorded and written as a Chrome trace at exit
+// (it can be opened with ui.perfetto.dev or chrome://tracing). every thread writes to its own ring buffer without locks,
+// when the ring is full the oldest events are overwritten
+#define TRACE_EVENTS (1 << 16) // events kept per thread, a power of two
+typedef struct {
+    long long time; // in nanoseconds
+    const char *name; // name of the step, a string literal
+    char phase; // 'B' for begin, 'E' for end
+} TraceEvent;
+
+typedef struct TraceBuffer {
+    TraceEvent events[TRACE_EVENTS];
+    unsigned long long count; // number of events recorded, the next one goes to count % TRACE_EVENTS
+    int thread_id;
+    struct TraceBuffer *next; // the buffers of all threads are kept in a list to be written at exit
+} TraceBuffer;
+
+bool tracing = false;
+long long trace_start = 0; // time of the start of tracing, the events are written relative to it
+TraceBuffer *_Atomic trace_buffers = NULL;
+_Atomic int trace_thread_count = 0;
+_Thread_local TraceBuffer *trace_buffer = NULL;
+
+// Function to record an event in the ring buffer of the thread, the buffer is created and added to the list at the first event
+void trace_event(const char *name, char phase) {
+    if (trace_buffer == NULL) {
+        trace_buffer = malloc(sizeof(TraceBuffer));
+        count_memory(MEMORY_BUFFERS, sizeof(TraceBuffer));
+        trace_buffer->count = 0;
+        trace_buffer->thread_id = atomic_fetch_add(&trace_thread_count, 1) + 1;
+        trace_buffer->next = atomic_load(&trace_buffers);
+        while (!atomic_compare_exchange_weak(&trace_buffers, &trace_buffer->next, trace_buffer)) {
+        }
+    }
+    TraceEvent *event = &trace_buffer->events[trace_buffer->count & (TRACE_EVENTS - 1)];
+    event->time = now_ns();
+    event->name = name;
+    event->phase = phase;
+    trace_buffer->count++;
+}
+
+// Function to record the begin of a step if tracing is on
+void trace_begin(const char *name) {
+    if (tracing) {
+        trace_event(name, 'B');
+    }
+}
+
+// Function to record the end of a step if tracing is on
+void trace_end(const char *name) {
+    if (tracing) {
+        trace_event(name, 'E');
+    }
+}
+
+// Function to write the recorded events of all threads to a file in Chrome trace event format, returns -1 if the file cannot be written
+// it is called when the threads are done
+int write_trace(char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+    fprintf(file, "{\"traceEvents\":[");
+    bool first = true;
+    for (TraceBuffer *buffer = atomic_load(&trace_buffers); buffer != NULL; buffer = buffer->next) {
+        unsigned long long oldest = buffer->count > TRACE_EVENTS ? buffer->count - TRACE_EVENTS : 0;
+        int depth = 0;
+        for (unsigned long long i = oldest; i < buffer->count; i++) {
+            TraceEvent *event = &buffer->events[i & (TRACE_EVENTS - 1)];
+            // the begins of the oldest steps may be overwritten, their ends are skipped
+            if (event->phase == 'E' && depth == 0) {
+                continue;
+            }
+            depth += event->phase == 'B' ? 1 : -1;
+            fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", first ? "" : ",",
+                    event->name, event->phase, (event->time - trace_start) / 1000.0, buffer->thread_id);
+            first = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+// The input and output of the command loop go through io_uring if the kernel allows it, the next chunk of the input is read
+// while the current chunk is executed and the collected output is written while the next answers are collected.
+// if io_uring cannot be set up (old kernel, not Linux, or blocked by the sandbox), the same functions use blocking read and write
+#define IO_READ 0 // the read request, only one read can be waiting at a time
+#define IO_WRITE 1 // the write request, only one write can be waiting at a time
+
+// Struct for a read or write request
+typedef struct {
+    int fd;
+    char *buffer;
+    size_t length;
+    bool submitted; // true from submit_io until wait_io returns
+    bool done; // true when the result is known
+    long long result; // bytes read or written, or -errno
+} IoRequest;
+IoRequest io_requests[2];
+
+#ifdef __linux__
+// Struct for the submission and completion rings of io_uring, they are shared with the kernel
+typedef struct {
+    int fd;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+} Ring;
+Ring ring;
+#endif
+bool ring_enabled = false;
+
+// Function to set up io_uring, the blocking calls are used if it fails
+void setup_ring() {
+#ifdef __linux__
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, 4, &params);
+    if (fd < 0) {
+        return;
+    }
+    // map the rings, they are one mapping on newer kernels
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap && cq_size > sq_size) {
+        sq_size = cq_size;
+    }
+    char *sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    char *cq = single_mmap ? sq : mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    struct io_uring_sqe *sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    // reading and writing at the current file position is needed, stdin and stdout may be files
+    if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED || !(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(fd);
+        return;
+    }
+    ring.fd = fd;
+    ring.sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring.sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring.sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring.sqes = sqes;
+    ring.cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring.cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring.cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring_enabled = true;
+#endif
+}
+
+// Function to take the results of the completed requests from the completion ring, waits for one if wait is true
+void reap_completions(bool wait) {
+#ifdef __linux__
+    while (true) {
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            for (; head != tail; head++) {
+                struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+                io_requests[cqe->user_data].result = cqe->res;
+                io_requests[cqe->user_data].done = true;
+            }
+            __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+            return;
+        }
+        if (!wait) {
+            return;
+        }
+        syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    }
+#else
+    (void)wait;
+#endif
+}
+
+// Function to run a request with a blocking call
+void run_blocking(IoRequest *request, int kind) {
+    ssize_t result = kind == IO_READ ? read(request->fd, request->buffer, request->length) : write(request->fd, request->buffer, request->length);
+    request->result = result < 0 ? -errno : result;
+    request->done = true;
+}
+
+// Function to start reading into (or writing from) a buffer, the buffer should not be touched until wait_io returns
+// without io_uring, a write is done at once and a read is done when it is waited for (a read could block until the user types)
+void submit_io(int kind, int fd, char *buffer, size_t length) {
+    IoRequest *request = &io_requests[kind];
+    request->fd = fd;
+    request->buffer = buffer;
+    request->length = length;
+    request->submitted = true;
+    request->done = false;
+#ifdef __linux__
+    if (ring_enabled) {
+        unsigned tail = *ring.sq_tail;
+        unsigned index = tail & *ring.sq_mask;
+        struct io_uring_sqe *sqe = &ring.sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = kind == IO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = fd;
+        sqe->addr = (unsigned long)buffer;
+        sqe->len = length;
+        sqe->off = -1; // current file position
+        sqe->user_data = kind;
+        ring.sq_array[index] = index;
+        __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+        if (syscall(__NR_io_uring_enter, ring.fd, 1, 0, 0, NULL, 0) == 1) {
+            return;
+        }
+        // the kernel did not take the request, stop using io_uring
+        ring_enabled = false;
+    }
+#endif
+    if (kind == IO_WRITE) {
+        run_blocking(request, kind);
+    }
+}
+
+// Function to check whether a submitted request is completed, without waiting
+bool io_ready(int kind) {
+    if (ring_enabled && !io_requests[kind].done) {
+        reap_completions(false);
+    }
+    return io_requests[kind].done;
+}
+
+// Function to wait for a submitted request and return its result
+long long wait_io(int kind) {
+    IoRequest *request = &io_requests[kind];
+    while (ring_enabled && !request->done) {
+        reap_completions(true);
+    }
+    // kernels before 5.6 do not know IORING_OP_READ and IORING_OP_WRITE, do the request again with a blocking call
+    if (request->done && request->result == -EINVAL && ring_enabled) {
+        ring_enabled = false;
+        request->done = false;
+    }
+    if (!request->done) {
+        run_blocking(request, kind);
+    }
+    request->submitted = false;
+    return request->result;
+}
+
+// the output buffer that is being written while the other one collects the next answers
+_Thread_local char *written_buffer = NULL;
+_Thread_local size_t written_capacity = 0;
+
+// Function to wait until the output that is being written is written completely
+void finish_write() {
+    IoRequest *request = &io_requests[IO_WRITE];
+    while (request->submitted) {
+        long long written = wait_io(IO_WRITE);
+        // a short write (a full pipe for example) is continued, an error drops the rest of the output like fwrite does
+        if (written > 0 && (size_t)written < request->length) {
+            submit_io(IO_WRITE, request->fd, request->buffer + written, request->length - written);
+        }
+    }
+}
+
+// Function to start writing the output buffer to stdout and empty it, the buffers are swapped so answers can be collected meanwhile
+void flush_output() {
+    finish_write();
+    if (output_size == 0) {
+        return;
+    }
+    char *buffer = output_buffer;
+    size_t capacity = output_capacity;
+    output_buffer = written_buffer;
+    output_capacity = written_capacity;
+    written_buffer = buffer;
+    written_capacity = capacity;
+    submit_io(IO_WRITE, STDOUT_FILENO, written_buffer, output_size);
+    output_size = 0;
+}
+
+// Function to write all the output before the program exits
+void finish_output() {
+    flush_output();
+    finish_write();
+}
+
+// the input is read in chunks, the next chunk is read while the lines of the current one are executed
+char input_chunks[2][INPUT_CHUNK_SIZE];
+int input_chunk = 0; // chunk that lines are taken from, the read request fills the other one
+size_t input_position = 0;
+size_t input_length = 0;
+bool input_started = false;
+bool input_ended = false;
+
+// Function to move to the next chunk of the input, returns false at the end of the input
+bool next_input_chunk() {
+    if (input_ended) {
+        return false;
+    }
+    if (!input_started) {
+        input_started = true;
+        submit_io(IO_READ, STDIN_FILENO, input_chunks[1 - input_chunk], INPUT_CHUNK_SIZE);
+    }
+    // the output is written before waiting for input, the user should see the answers (and the prompt) first
+    if (!io_ready(IO_READ)) {
+        flush_output();
+    }
+    long long length = wait_io(IO_READ);
+    if (length <= 0) {
+        input_ended = true;
+        return false;
+    }
+    input_chunk = 1 - input_chunk;
+    input_position = 0;
+    input_length = length;
+    // start reading the chunk after this one into the chunk that is finished
+    submit_io(IO_READ, STDIN_FILENO, input_chunks[1 - input_chunk], INPUT_CHUNK_SIZE);
+    return true;
+}
+
+// Function to read a line from stdin like fgets, at most size - 1 characters are read and the new line is kept
+// returns NULL at the end of the input
+char* read_input_line(char *line, int size) {
+    if (output_size >= OUTPUT_FLUSH_SIZE) {
+        flush_output();
+    }
+    int count = 0;
+    while (count < size - 1) {
+        if (input_position == input_length && !next_input_chunk()) {
+            break;
+        }
+        // copy until the new line, or the end of the chunk, or the end of the line buffer
+        char *start = input_chunks[input_chunk] + input_position;
+        size_t available = input_length - input_position;
+        if (available > (size_t)(size - 1 - count)) {
+            available = size - 1 - count;
         }
+        char *new_line = memchr(start, '\n', available);
+        size_t length = new_line == NULL ? available : (size_t)(new_line - start) + 1;
+        memcpy(line + count, start, length);
+        count += length;
+        input_position += length;
+        if (new_line != NULL) {
+            break;
+        }
+    }
+    if (count == 0) {
+        return NULL;
+    }
+    line[count] = '\0';
+    return line;
+}
+
+// Function to convert a string of digits to a number (used instead of atoi), returns -1 if it is not a number or it is greater than max
+// overflow is checked with the compiler builtins, they use the overflow flag of the multiplication and addition so the loop stays short
+long long parse_number(const char *str, long long max) {
+    const char *start = str;
+    long long value = 0;
+    bool overflow = false;
+    unsigned int digit;
+    while ((digit = (unsigned char)*str - '0') <= 9) {
+        overflow |= __builtin_mul_overflow(value, 10, &value);
+        overflow |= __builtin_add_overflow(value, (long long)digit, &value);
         str++;
     }
-    return true; // All characters are digits
+    if (*str != '\0' || str == start || overflow || value > max) {
+        return -1;
+    }
+    return value;
+}
+
+// Function to check whether a string is a number that can be used as a quantity
+bool is_numeric_string(char *str) {
+    return parse_number(str, QUANTITY_MAX) != -1;
 }
 
 
@@ -65,6 +589,11 @@ bool is_valid_word(char *str) {
         return false;
     }
 
+    // a name longer than MAX_NAME_LENGTH does not fit in the name pool (imported names can be longer than the input)
+    if (strlen(str) > MAX_NAME_LENGTH) {
+        return false;
+    }
+
     while (*str) {
         // Check if the character is a letter or underscore
         if (!(isalpha(*str) || *str == '_')) {
@@ -79,47 +608,400 @@ bool is_valid_word(char *str) {
 // 2. Structures for Subject, Item and Location
 //
 
-// Struct for Item 
+// Names of subjects, items and locations are kept once in a shared name pool and structures refer to them with
+// 32-bit ids, so a name can be up to MAX_NAME_LENGTH long and two names are equal when their ids are equal
+// the pool is shared by all versions of the world (see World below), it only grows and a name never moves after it is added,
+// so readers can use the names of the version they read while a writer adds new names
+#define MAX_NAME_CHUNKS (1u << (32 - NAME_CHUNK_BITS))
+char *name_chunks[MAX_NAME_CHUNKS]; // names seperated with '\0', allocated when needed
+unsigned int name_chunk_count = 0;
+unsigned int name_chunk_used = 0; // bytes used in the last chunk
+unsigned int *name_table = NULL; // open addressing hash table of (name id + 1) to deduplicate names, 0 for empty slots
+unsigned int name_table_capacity = 0; // always a power of two
+unsigned int name_count = 0;
+pthread_rwlock_t name_table_lock = PTHREAD_RWLOCK_INITIALIZER; // readers look names up, writers add them
+
+// Function to get the name of a name id
+char* name_of(unsigned int name_id) {
+    return name_chunks[name_id >> NAME_CHUNK_BITS] + (name_id & (NAME_CHUNK_SIZE - 1));
+}
+
+// Function to get the length of a name, every name in the pool is preceded by its length so answers can copy names without strlen
+unsigned int name_length(unsigned int name_id) {
+    unsigned int length;
+    memcpy(&length, name_of(name_id) - sizeof(length), sizeof(length));
+    return length;
+}
+
+// Function to add a name to the output buffer
+void out_name(unsigned int name_id) {
+    out_append(name_of(name_id), name_length(name_id));
+}
+
+// Function to hash a name (FNV-1a)
+unsigned int hash_name(const char *name) {
+    unsigned int hash = 2166136261u;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Function to find the slot of a name in the name table, the slot is empty if the name is not in the pool
+unsigned int find_name_slot(const char *name) {
+    unsigned int mask = name_table_capacity - 1;
+    unsigned int slot = hash_name(name) & mask;
+    while (name_table[slot] != 0 && strcmp(name_of(name_table[slot] - 1), name) != 0) {
+        slot = (slot + 1) & mask; // linear probing
+    }
+    return slot;
+}
+
+// Function to get the id of a name without adding it to the pool, returns false if the name is not in the pool
+bool find_name(const char *name, unsigned int *name_id) {
+    bool found = false;
+    pthread_rwlock_rdlock(&name_table_lock);
+    if (name_count != 0) {
+        unsigned int slot = find_name_slot(name);
+        if (name_table[slot] != 0) {
+            *name_id = name_table[slot] - 1;
+            found = true;
+        }
+    }
+    pthread_rwlock_unlock(&name_table_lock);
+    return found;
+}
+
+// Function to get the id of a name, the name is added to the pool if it is not there already
+unsigned int intern_name(const char *name) {
+    pthread_rwlock_wrlock(&name_table_lock);
+    // keep the table at most half full, double it and insert the names again if it is not
+    if (2 * (name_count + 1) > name_table_capacity) {
+        unsigned int old_capacity = name_table_capacity;
+        unsigned int *old_table = name_table;
+        name_table_capacity = old_capacity == 0 ? 64 : old_capacity * 2;
+        name_table = calloc(name_table_capacity, sizeof(unsigned int));
+        count_memory(MEMORY_INDEXES, (long long)(name_table_capacity - old_capacity) * sizeof(unsigned int));
+        for (unsigned int i = 0; i < old_capacity; i++) {
+            if (old_table[i] != 0) {
+                name_table[find_name_slot(name_of(old_table[i] - 1))] = old_table[i];
+            }
+        }
+        free(old_table);
+    }
+
+    unsigned int slot = find_name_slot(name);
+    if (name_table[slot] != 0) {
+        // name is already in the pool, take its id before unlocking since another writer may grow the table after that
+        unsigned int name_id = name_table[slot] - 1;
+        pthread_rwlock_unlock(&name_table_lock);
+        return name_id;
+    }
+
+    // append the length and the name to the last chunk, start a new chunk if they do not fit
+    unsigned int length = strlen(name);
+    if (name_chunk_count == 0 || name_chunk_used + sizeof(length) + length + 1 > NAME_CHUNK_SIZE) {
+        name_chunks[name_chunk_count++] = malloc(NAME_CHUNK_SIZE);
+        count_memory(MEMORY_NAMES, NAME_CHUNK_SIZE);
+        name_chunk_used = 0;
+    }
+    memcpy(name_chunks[name_chunk_count - 1] + name_chunk_used, &length, sizeof(length));
+    name_chunk_used += sizeof(length);
+    unsigned int name_id = ((name_chunk_count - 1) << NAME_CHUNK_BITS) | name_chunk_used;
+    memcpy(name_chunks[name_chunk_count - 1] + name_chunk_used, name, length + 1);
+    name_chunk_used += length + 1;
+
+    name_table[slot] = name_id + 1;
+    name_count++;
+    pthread_rwlock_unlock(&name_table_lock);
+    return name_id;
+}
+
+// Struct for Item, its quantity is kept in the quantity column of its ItemType
 typedef struct {
-    char name[MAX_NAME_LENGTH];
-    int quantity;
+    unsigned int name; // name id in the name pool
+    int type_id; // index of the item's ItemType in item_types list
 } Item;
 
 // Struct for Subject 
 typedef struct {
-    char name[MAX_NAME_LENGTH];
+    unsigned int name; // name id in the name pool
     int item_count;  // Number of items in subjects inventory
-    Item items[MAX_ITEMS];
-    char location_name[MAX_NAME_LENGTH];
+    Item items[MAX_ITEMS]; // items in the order they are first bought
+    int item_order[MAX_ITEMS]; // indices of items sorted by name id, to search the inventory with binary search
+    int zero_count; // number of items with 0 quantity, their slots are reclaimed by compaction
+    unsigned int location_name; // name id of the subject's location
+    unsigned int version; // incremented whenever the inventory or location of the subject changes, to validate cached answers
 } Subject;
 
 // Struct for Location
 typedef struct {
-    char name[MAX_NAME_LENGTH];
-    Subject *subjects[MAX_SUBJECTS];
+    unsigned int name; // name id in the name pool
+    int subjects[MAX_SUBJECTS]; // indices of the subjects in the order they arrived
     int subject_count; // Number of subjects in location
+    unsigned int version; // incremented whenever a subject arrives or leaves, to validate cached answers
 } Location;
 
 
-// all subjects list to access a subject
-Subject subjects[MAX_SUBJECTS];
-int num_subjects = 0;
-
-// all locations list to access a location
-Location locations[MAX_LOCATIONS];
-int num_locations = 0;
+// Struct for ItemType, there is one for every distinct item name and it ranks the holders of that item
+// the quantities of an item for all subjects are kept together in one column, so that world-wide questions
+// scan one contiguous array instead of every Subject's inventory (names stay in the name pool)
+typedef struct {
+    long long quantity[MAX_SUBJECTS] __attribute__((aligned(32))); // quantity held by each subject, indexed by subject index, 0 for unused subjects
+    unsigned int name; // name id in the name pool
+    int heap[MAX_SUBJECTS]; // subject indices as a max-heap ordered by quantity (ties are ordered by subject index)
+    int heap_pos[MAX_SUBJECTS]; // position of each subject in the heap, indexed by subject index
+    int heap_size; // number of subjects in the heap
+    int id; // index of the item type in item_types list
+    unsigned long long epoch; // epoch of the world version that made this copy, see writable_item_type
+} ItemType;
+
+// Struct for one version of the world, questions read a version while a writer prepares the next one
+// subjects and locations are copied for every version, item types are shared between versions until a writer changes them
+struct World {
+    unsigned long long epoch; // versions are numbered from 1, a new version gets the next epoch
+
+    // all subjects list to access a subject
+    Subject subjects[MAX_SUBJECTS];
+    int num_subjects;
+
+    // all locations list to access a location
+    Location locations[MAX_LOCATIONS];
+    int num_locations;
+
+    // all item types list to rank the holders of an item
+    ItemType *item_types[MAX_ITEM_TYPES];
+    int num_item_types;
+};
+
+// the version of the world the current thread reads (or writes, inside begin_write and publish_write)
+_Thread_local World *world = NULL;
+
+// Readers pin the epoch of the version they read in a slot, memory that only older versions use is freed
+// when no pinned epoch is older than the version that replaced it (epoch-based reclamation)
+#define MAX_READERS 64
+
+// Struct for memory that is not used by the latest version anymore, it is freed when the readers move past retire_epoch
+typedef struct Retired {
+    void *memory;
+    bool is_world; // a World or an ItemType
+    unsigned long long retire_epoch; // epoch of the version that stopped using the memory
+    struct Retired *next;
+} Retired;
+
+// Struct for all versions of one world and their history, threads that share the world use the same store
+// the command loop has one store, the test runner makes a new one for every case
+typedef struct {
+    World *_Atomic published_world; // the latest published version, readers start from it
+    _Atomic unsigned long long published_epoch; // epoch of published_world, stored after it
+    pthread_mutex_t write_lock; // writers prepare one version at a time
+    _Atomic unsigned long long reader_epochs[MAX_READERS]; // 0 if the reader is not reading
+    _Atomic bool reader_slot_used[MAX_READERS];
+    Retired *retired_list; // only changed by writers, under write_lock
+    History *history; // changes of the world over time
+    _Atomic long long command_time; // number of the command that is executed, changes are recorded in the history with it
+} Store;
+
+// the store of the current thread and the thread's reader slot in it
+// a thread that finds no free slot reads under write_lock instead, so no version is retired while it reads
+_Thread_local Store *store = NULL;
+_Thread_local int reader_slot = -1;
+_Thread_local bool reading_locked = false;
 
 //
 // 3. Structure controlling functions (getters and creaters)
 //
 
+// Function to count the memory of a version of the world, sign is 1 when it is allocated and -1 when it is freed
+void count_world(int sign) {
+    long long subjects_size = sizeof(((World *)NULL)->subjects);
+    long long locations_size = sizeof(((World *)NULL)->locations);
+    count_memory(MEMORY_SUBJECTS, sign * subjects_size);
+    count_memory(MEMORY_LOCATIONS, sign * locations_size);
+    count_memory(MEMORY_INDEXES, sign * ((long long)sizeof(World) - subjects_size - locations_size));
+}
+
+// Function to count the memory of an ItemType, the quantity column is counted for items and the heap for indexes
+void count_item_type(int sign) {
+    long long column_size = sizeof(((ItemType *)NULL)->quantity);
+    count_memory(MEMORY_ITEMS, sign * column_size);
+    count_memory(MEMORY_INDEXES, sign * ((long long)sizeof(ItemType) - column_size));
+}
+
+// Function to create a store with an empty world
+Store* create_store() {
+    Store *new_store = calloc(1, sizeof(Store));
+    pthread_mutex_init(&new_store->write_lock, NULL);
+    new_store->history = create_history();
+
+    // the first version is empty
+    World *first = calloc(1, sizeof(World));
+    count_world(1);
+    first->epoch = 1;
+    atomic_store(&new_store->published_world, first);
+    atomic_store(&new_store->published_epoch, first->epoch);
+    return new_store;
+}
+
+// Function to give the reader slot of the current thread back to the store, a thread calls it when it stops using the store
+void release_reader() {
+    if (reader_slot != -1) {
+        atomic_store(&store->reader_epochs[reader_slot], 0);
+        atomic_store(&store->reader_slot_used[reader_slot], false);
+        reader_slot = -1;
+    }
+}
+
+// Function to make a store the store of the current thread, the answers cached for another store are dropped
+void bind_store(Store *new_store) {
+    if (store != NULL) {
+        release_reader();
+    }
+    store = new_store;
+    world = atomic_load(&store->published_world);
+    clear_answer_cache();
+}
+
+// Function to pin the latest published version for reading, every question reads one version from start to end
+// the epoch is pinned before the version is loaded, so a writer that does not see the pin has already published a newer version
+void pin_world() {
+    // take a free reader slot the first time the thread reads, every slot is tried once
+    for (int i = 0; reader_slot == -1 && i < MAX_READERS; i++) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&store->reader_slot_used[i], &expected, true)) {
+            reader_slot = i;
+        }
+    }
+    if (reader_slot == -1) {
+        // all slots are taken, writers wait until this read ends
+        pthread_mutex_lock(&store->write_lock);
+        reading_locked = true;
+    } else {
+        atomic_store(&store->reader_epochs[reader_slot], atomic_load(&store->published_epoch));
+    }
+    world = atomic_load(&store->published_world);
+}
+
+// Function to unpin the version that is read, the memory of older versions can be freed after that
+void unpin_world() {
+    if (reading_locked) {
+        reading_locked = false;
+        pthread_mutex_unlock(&store->write_lock);
+    } else {
+        atomic_store(&store->reader_epochs[reader_slot], 0);
+    }
+}
+
+// Function to mark a World or an ItemType as not used by versions from retire_epoch on
+void retire(void *memory, bool is_world, unsigned long long retire_epoch) {
+    Retired *retired = malloc(sizeof(Retired));
+    retired->memory = memory;
+    retired->is_world = is_world;
+    retired->retire_epoch = retire_epoch;
+    retired->next = store->retired_list;
+    store->retired_list = retired;
+}
+
+// Function to free the retired memory that no reader can be using
+void collect_garbage() {
+    // the oldest pinned epoch, readers that pin after this scan read the published version or a newer one
+    unsigned long long oldest = atomic_load(&store->published_epoch);
+    for (int i = 0; i < MAX_READERS; i++) {
+        unsigned long long epoch = atomic_load(&store->reader_epochs[i]);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    Retired **link = &store->retired_list;
+    while (*link != NULL) {
+        Retired *retired = *link;
+        if (retired->retire_epoch <= oldest) {
+            *link = retired->next;
+            if (retired->is_world) {
+                count_world(-1);
+            } else {
+                count_item_type(-1);
+            }
+            free(retired->memory);
+            free(retired);
+        } else {
+            link = &retired->next;
+        }
+    }
+}
+
+// Function to free a store that no thread uses anymore
+void free_store(Store *old_store) {
+    Store *bound = store;
+    if (bound == old_store) {
+        release_reader();
+    }
+    store = old_store;
+    collect_garbage(); // nobody reads, every retired version is freed
+    World *latest = atomic_load(&old_store->published_world);
+    for (int i = 0; i < latest->num_item_types; i++) {
+        count_item_type(-1);
+        free(latest->item_types[i]);
+    }
+    count_world(-1);
+    free(latest);
+    free_history(old_store->history);
+    pthread_mutex_destroy(&old_store->write_lock);
+    free(old_store);
+    store = bound == old_store ? NULL : bound;
+}
+
+// Function to start writing a new version, the new version is a copy of the latest one and nobody reads it until it is published
+void begin_write() {
+    pthread_mutex_lock(&store->write_lock);
+    World *latest = atomic_load(&store->published_world);
+    World *next = malloc(sizeof(World));
+    count_world(1);
+    memcpy(next, latest, sizeof(World));
+    next->epoch = latest->epoch + 1;
+    world = next;
+}
+
+// Function to publish the version that is written, questions asked after this returns read it
+void publish_write() {
+    World *previous = atomic_load(&store->published_world);
+    record_history(previous, world);
+    atomic_store(&store->published_world, world);
+    atomic_store(&store->published_epoch, world->epoch);
+    retire(previous, true, world->epoch);
+    collect_garbage();
+    pthread_mutex_unlock(&store->write_lock);
+}
+
+// Function to get an ItemType that can be changed in the version being written
+// if the item type is still shared with older versions, it is copied first and the old copy is retired
+ItemType* writable_item_type(int type_id) {
+    ItemType *type = world->item_types[type_id];
+    if (type->epoch != world->epoch) {
+        ItemType *copy = aligned_alloc(32, sizeof(ItemType));
+        count_item_type(1);
+        memcpy(copy, type, sizeof(ItemType));
+        copy->epoch = world->epoch;
+        retire(type, false, world->epoch);
+        world->item_types[type_id] = copy;
+        type = copy;
+    }
+    return type;
+}
+
 // Function to get the Subject by using name
 Subject* get_subject(char *name) {
+    // if the name is not in the name pool, there is no such subject
+    unsigned int name_id;
+    if (!find_name(name, &name_id)) {
+        return NULL;
+    }
     // Search for the subject with the specified name in subjects list
-    for (int i = 0; i < num_subjects; i++) {
-        if (strcmp(subjects[i].name, name) == 0) {
+    for (int i = 0; i < world->num_subjects; i++) {
+        if (world->subjects[i].name == name_id) {
             // Subject found, return the pointer to subject
-            return &subjects[i];
+            return &world->subjects[i];
         }
     }
     // Subject not found
@@ -138,34 +1020,137 @@ Subject* create_subject(char *name) {
     if(is_keyword(name)) {
         return NULL;
     }
+    // return NULL if there is no space for a new subject
+    if (world->num_subjects == MAX_SUBJECTS) {
+        return NULL;
+    }
 
     // Create a new subject
-    Subject *new_subject = &subjects[num_subjects++];
-    strcpy(new_subject->name, name);
+    Subject *new_subject = &world->subjects[world->num_subjects++];
+    new_subject->name = intern_name(name);
     new_subject->item_count = 0; // initialize the item count as 0
-    strcpy(new_subject->location_name, "NOWHERE"); // initialize the location as "NOWHERE" (this may be unnecessary to initialize here)
+    new_subject->zero_count = 0;
+    new_subject->location_name = intern_name("NOWHERE"); // initialize the location as "NOWHERE" (this may be unnecessary to initialize here)
+    new_subject->version = 0;
 
     // return the pointer to subject
     return new_subject;
 }
 
+// Function to get the ItemType by using item name
+ItemType* get_item_type(char *name) {
+    // if the name is not in the name pool, there is no such item type
+    unsigned int name_id;
+    if (!find_name(name, &name_id)) {
+        return NULL;
+    }
+    // Search for the item type with the specified name in item types list
+    for (int i = 0; i < world->num_item_types; i++) {
+        if (world->item_types[i]->name == name_id) {
+            // Item type found, return the pointer to item type
+            return world->item_types[i];
+        }
+    }
+    // Item type not found
+    return NULL;
+}
+
+// Function to create a new ItemType or return an existing ItemType if it is already created
+ItemType* create_item_type(char *name) {
+    // Check if the item type already exists
+    ItemType *type = get_item_type(name);
+    if (type != NULL) {
+        return type;
+    }
+    // return NULL if there is no space for a new item type
+    if (world->num_item_types == MAX_ITEM_TYPES) {
+        return NULL;
+    }
+
+    // Create a new item type with an empty heap, it belongs to the version being written
+    ItemType *new_type = aligned_alloc(32, sizeof(ItemType));
+    count_item_type(1);
+    new_type->id = world->num_item_types;
+    world->item_types[world->num_item_types++] = new_type;
+    new_type->epoch = world->epoch;
+    new_type->name = intern_name(name);
+    new_type->heap_size = 0;
+    for (int i = 0; i < MAX_SUBJECTS; i++) {
+        new_type->quantity[i] = 0;
+        new_type->heap_pos[i] = -1; // -1 means the subject is not in the heap
+    }
+
+    // return the pointer to item type
+    return new_type;
+}
+
+// Function to get the quantity of an Item of a Subject from the quantity column of its ItemType
+long long item_quantity(Item *item, Subject *subject) {
+    return world->item_types[item->type_id]->quantity[subject - world->subjects];
+}
+
+// Function to find the position of an item name id in the sorted item order of a Subject with binary search
+// returns the position of the item if it exists, otherwise the position that the item should be inserted to
+int find_item_position(unsigned int item_name, Subject *subject) {
+    int low = 0;
+    int high = subject->item_count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (subject->items[subject->item_order[mid]].name < item_name) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
 // Function to get the Item of a Subject by using item name
 Item* get_item_of_subject(char *item_name, Subject *subject) {
     // Search for the item with the specified name in Subject's inventory
     // if there is no subject, return NULL
-    if (subject == NULL) {
+    // if the name is not in the name pool, nobody has the item
+    unsigned int name_id;
+    if (subject == NULL || !find_name(item_name, &name_id)) {
         return NULL;
     }
-    for (int i = 0; i < subject->item_count; i++) {
-        if (strcmp(subject->items[i].name, item_name) == 0) {
-            // Item found, return the pointer to item
-            return &subject->items[i];
-        }
+    int pos = find_item_position(name_id, subject);
+    if (pos < subject->item_count && subject->items[subject->item_order[pos]].name == name_id) {
+        // Item found, return the pointer to item
+        return &subject->items[subject->item_order[pos]];
     }
     // Item not found
     return NULL;
 }
 
+// Function to remove the items with 0 quantity from a Subject's inventory, the order of the remaining items is kept
+// it is only called when the inventory is full, so until then a sold out item keeps its place if it is bought again
+void compact_inventory(Subject *subject) {
+    if (subject->zero_count == 0) {
+        return;
+    }
+    // slide the items with a quantity to the front, remember where each old index moved (-1 if removed)
+    int new_index[MAX_ITEMS];
+    int count = 0;
+    for (int i = 0; i < subject->item_count; i++) {
+        if (item_quantity(&subject->items[i], subject) == 0) {
+            new_index[i] = -1;
+            continue;
+        }
+        new_index[i] = count;
+        subject->items[count++] = subject->items[i];
+    }
+    // the sorted order of the remaining items does not change, just renumber them
+    int order_count = 0;
+    for (int i = 0; i < subject->item_count; i++) {
+        if (new_index[subject->item_order[i]] != -1) {
+            subject->item_order[order_count++] = new_index[subject->item_order[i]];
+        }
+    }
+    subject->item_count = count;
+    subject->zero_count = 0;
+}
+
 // Function to create a new Item of a Subject or return an existing Item if it is already created
 Item* create_item_of_subject(char *item_name, Subject *subject) {
 
@@ -181,9 +1166,30 @@ Item* create_item_of_subject(char *item_name, Subject *subject) {
         return NULL;
     }
 
-    // Create a new item if it does not exist
+    // if the inventory is full, reclaim the slots of the items with 0 quantity, return NULL if there is still no slot
+    if (subject->item_count == MAX_ITEMS) {
+        compact_inventory(subject);
+        if (subject->item_count == MAX_ITEMS) {
+            return NULL;
+        }
+    }
+
+    // get the item type to rank the holders, create if it does not exist
+    ItemType *type = create_item_type(item_name);
+    if (type == NULL) {
+        return NULL;
+    }
+
+    // insert the new item to its place in the sorted item order
+    int pos = find_item_position(type->name, subject);
+    memmove(&subject->item_order[pos + 1], &subject->item_order[pos], (subject->item_count - pos) * sizeof(int));
+    subject->item_order[pos] = subject->item_count;
+
+    // Create a new item if it does not exist, it starts with 0 quantity
     Item *new_item = &subject->items[subject->item_count++];
-    strcpy(new_item->name, item_name);
+    new_item->name = type->name;
+    new_item->type_id = type->id;
+    subject->zero_count++;
 
     // return the pointer to item
     return new_item;
@@ -191,11 +1197,16 @@ Item* create_item_of_subject(char *item_name, Subject *subject) {
 
 // Function to get the location by using name
 Location* get_location(char *name) {
+    // if the name is not in the name pool, there is no such location
+    unsigned int name_id;
+    if (!find_name(name, &name_id)) {
+        return NULL;
+    }
     // Search for the location with the specified name in locations list
-    for (int i = 0; i < num_locations; i++) {
-        if (strcmp(locations[i].name, name) == 0) {
+    for (int i = 0; i < world->num_locations; i++) {
+        if (world->locations[i].name == name_id) {
             // Location found, return the pointer to location
-            return &locations[i];
+            return &world->locations[i];
         }
     }
 
@@ -217,52 +1228,146 @@ Location* create_location(char *name) {
     if(is_keyword(name)) {
         return NULL;
     }
+    // return NULL if there is no space for a new location
+    if (world->num_locations == MAX_LOCATIONS) {
+        return NULL;
+    }
     // Create a new location
-    Location *new_location = &locations[num_locations++];
-    strcpy(new_location->name, name);
+    Location *new_location = &world->locations[world->num_locations++];
+    new_location->name = intern_name(name);
+    new_location->version = 0;
 
     // return the pointer to location
     return new_location;
 }
 
-//
-// 4. Action functions
-//
-
-// Function to add an item to a subject with a quantity
-int add_item_to_subject(Subject *subject, char *item_name, int quantity) {
-    // Check if the item already exists, if not create one
-    Item *item = create_item_of_subject(item_name, subject);
-    // return -1 if there is a problem creating the item (may be unnecesary)
-    if (item == NULL) {
-        return -1;
+// Function to check whether subject a ranks before subject b for an item type
+bool ranks_before(ItemType *type, int a, int b) {
+    if (type->quantity[a] != type->quantity[b]) {
+        return type->quantity[a] > type->quantity[b];
     }
-    // update the quantity
-    item->quantity += quantity;
-    return 0;
+    // if the quantities are equal, the subject that is created first ranks before
+    return a < b;
 }
 
-// Function to subtract an item from a subject with quantity 
-int subtract_item_from_subject(Subject *subject, char *item_name, int quantity) {
-    // check if item exists
-    Item *item = get_item_of_subject(item_name, subject);
-
-    if (item == NULL) {
-        return 0; // if item is not found, do nothing, return
-    }
-    // update the quantity
-    item->quantity -= quantity;
-    // if all items removed, make the quantity 0, it cannot be negative
-    if (item->quantity < 0) {
-        item->quantity = 0;
-    }
-
-    return 0;
-
+// Function to swap two positions of the heap and keep the positions of the subjects updated
+void heap_swap(ItemType *type, int i, int j) {
+    int temp = type->heap[i];
+    type->heap[i] = type->heap[j];
+    type->heap[j] = temp;
+    type->heap_pos[type->heap[i]] = i;
+    type->heap_pos[type->heap[j]] = j;
+}
+
+// Function to move a subject down in the heap while one of its children ranks before it
+void heap_sift_down(ItemType *type, int pos) {
+    while (true) {
+        int best = pos;
+        int left = 2 * pos + 1;
+        int right = 2 * pos + 2;
+        if (left < type->heap_size && ranks_before(type, type->heap[left], type->heap[best])) {
+            best = left;
+        }
+        if (right < type->heap_size && ranks_before(type, type->heap[right], type->heap[best])) {
+            best = right;
+        }
+        if (best == pos) {
+            break;
+        }
+        heap_swap(type, pos, best);
+        pos = best;
+    }
+}
+
+// Function to update the quantity a subject holds of an item type and restore the heap order, O(log n)
+void rank_update(ItemType *type, int subject_index, long long quantity) {
+    type->quantity[subject_index] = quantity;
+
+    int pos = type->heap_pos[subject_index];
+    if (pos == -1) {
+        // if the subject is not in the heap yet, add it to the end
+        pos = type->heap_size++;
+        type->heap[pos] = subject_index;
+        type->heap_pos[subject_index] = pos;
+    }
+
+    // move the subject up while it ranks before its parent
+    while (pos > 0 && ranks_before(type, type->heap[pos], type->heap[(pos - 1) / 2])) {
+        heap_swap(type, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+    heap_sift_down(type, pos);
+}
+
+// Function to build the heap of an item type from scratch in O(n), used after bulk imports
+// every subject that holds the item (or was ranked before) is put in the heap
+void rebuild_heap(ItemType *type) {
+    int heap_size = 0;
+    for (int i = 0; i < world->num_subjects; i++) {
+        if (type->heap_pos[i] != -1 || type->quantity[i] != 0) {
+            type->heap[heap_size] = i;
+            type->heap_pos[i] = heap_size++;
+        }
+    }
+    type->heap_size = heap_size;
+    for (int pos = heap_size / 2 - 1; pos >= 0; pos--) {
+        heap_sift_down(type, pos);
+    }
+}
+
+//
+// 4. Action functions
+//
+
+// Function to add an item to a subject with a quantity
+int add_item_to_subject(Subject *subject, char *item_name, long long quantity) {
+    // Check if the item already exists, if not create one
+    Item *item = create_item_of_subject(item_name, subject);
+    // return -1 if there is a problem creating the item (may be unnecesary)
+    if (item == NULL) {
+        return -1;
+    }
+    // the new quantity should not pass QUANTITY_MAX, return -1 if it does
+    long long old_quantity = item_quantity(item, subject);
+    long long new_quantity;
+    if (__builtin_add_overflow(old_quantity, quantity, &new_quantity) || new_quantity > QUANTITY_MAX) {
+        return -1;
+    }
+    // update the quantity and the rank of subject for this item
+    if (old_quantity == 0 && quantity > 0) {
+        subject->zero_count--;
+    }
+    rank_update(writable_item_type(item->type_id), subject - world->subjects, new_quantity);
+    subject->version++;
+    return 0;
+}
+
+// Function to subtract an item from a subject with quantity 
+int subtract_item_from_subject(Subject *subject, char *item_name, long long quantity) {
+    // check if item exists
+    Item *item = get_item_of_subject(item_name, subject);
+
+    if (item == NULL) {
+        return 0; // if item is not found, do nothing, return
+    }
+    // if all items removed, make the quantity 0, it cannot be negative, the slot of the item will be reclaimed later
+    long long new_quantity = item_quantity(item, subject) - quantity;
+    if (new_quantity <= 0) {
+        if (item_quantity(item, subject) != 0) {
+            subject->zero_count++;
+        }
+        new_quantity = 0;
+    }
+    // update the quantity and the rank of subject for this item
+    rank_update(writable_item_type(item->type_id), subject - world->subjects, new_quantity);
+    subject->version++;
+
+    return 0;
+
 }
 
 // Function to execute the buy function between a seller subject and a buyer subject
-int buy_from(Subject* buyer_subject, Subject *seller_subject, char *item_name, int quantity) {
+int buy_from(Subject* buyer_subject, Subject *seller_subject, char *item_name, long long quantity) {
     // check if the buyer and seller are same subjects, if so return -1 since this is invalid
     if (buyer_subject == seller_subject) {
         return -1;
@@ -272,7 +1377,7 @@ int buy_from(Subject* buyer_subject, Subject *seller_subject, char *item_name, i
     if (sellers_item == NULL) {
         return 0; // not invalid, just return
     }
-    if (sellers_item->quantity < quantity) {
+    if (item_quantity(sellers_item, seller_subject) < quantity) {
         return 0; // not invalid, just return
     }
     // if there are enought items, execute the buy action (subtract the item from seller and add to the buyer), check if the operations are successful, return -1 if there are problems
@@ -287,30 +1392,34 @@ int buy_from(Subject* buyer_subject, Subject *seller_subject, char *item_name, i
 // Function to change the location of a subject
 int change_location(Subject *subject, Location *location) {
     // if the subject belongs to another location, remove it from subject list of that location
-    Location* old_location = get_location(subject->location_name);
+    Location* old_location = get_location(name_of(subject->location_name));
     if (old_location != NULL && old_location != location) {
         for (int i = 0; i < old_location->subject_count; i++) {
-            if (old_location->subjects[i] == subject) {
-                // change the element in found index with the last element and then make the last element null and decrement the subject count
-                old_location->subjects[i] = old_location->subjects[old_location->subject_count];
-                old_location->subjects[old_location->subject_count] = NULL;
+            if (old_location->subjects[i] == subject - world->subjects) {
+                // change the element in found index with the last element and then decrement the subject count
                 old_location->subject_count--;
+                old_location->subjects[i] = old_location->subjects[old_location->subject_count];
                 break;
             }
         }
+        old_location->version++;
     }
 
     // change the subject's location
-    strcpy(subject->location_name, location->name);
+    if (subject->location_name != location->name) {
+        subject->location_name = location->name;
+        subject->version++;
+    }
     // add the subject to location's subject list if it is not there already
     for (int i = 0; i < location->subject_count; i++) {
-        if (subject == location->subjects[i]) {
+        if (subject - world->subjects == location->subjects[i]) {
             // do nothing
             return 0;
         }
     }
     // if the subject is not in location, add it
-    location->subjects[location->subject_count++] = subject;
+    location->subjects[location->subject_count++] = subject - world->subjects;
+    location->version++;
 
     return 0;
 
@@ -321,7 +1430,7 @@ int change_location(Subject *subject, Location *location) {
 //
 
 // Function to get the quantity of an item of a subject (we have a function to get the Item pointer above, this returns the quantity directly)
-int get_subject_item_quantity(char* subject_name, char* item_name) {
+long long get_subject_item_quantity(char* subject_name, char* item_name) {
 
     Subject *subject = get_subject(subject_name);
     // if there is no such subject, return 0
@@ -332,7 +1441,7 @@ int get_subject_item_quantity(char* subject_name, char* item_name) {
 
     // if the item is found, return the quantity
     if (item != NULL) {
-        return item->quantity;
+        return item_quantity(item, subject);
     }
     // if there is no item, return 0
     return 0;
@@ -343,33 +1452,29 @@ int print_all_items(char* name) {
 
     Subject *subject = get_subject(name);
     if (subject != NULL) {
-        int notemptyflag = 0; // flag to indicate if the inventory is empty (nothing besides items with 0 quantities) or not
-        for (int i = 0; i < subject->item_count; i++) { // search the inventory to see if there are any items with a quantity more than 0
-            if (subject->items[i].quantity != 0) {
-                notemptyflag++;
-                break;
-            }
-        }
-        // if the inventory is empty, print "NOTHING"
-        if (notemptyflag == 0) {
-            printf("NOTHING\n");
+        // if the inventory is empty (nothing besides items with 0 quantities), print "NOTHING"
+        if (subject->item_count == subject->zero_count) {
+            out_string("NOTHING\n");
             return 0;
         }
         // else print all items with quantities and names
+        int printed = 0;
         for (int i = 0; i < subject->item_count; i++) {
-            if (subject->items[i].quantity == 0) { // ignore the items with 0 quantities
+            long long quantity = item_quantity(&subject->items[i], subject);
+            if (quantity == 0) { // ignore the items with 0 quantities that are not reclaimed yet
                 continue;
-            } else {
-                printf("%d %s", subject->items[i].quantity, subject->items[i].name);
-                if (i != subject->item_count -1) {
-                    printf(" and "); // add "and" between items
-                }
             }
+            if (printed++ != 0) {
+                out_append(" and ", 5); // add "and" between items
+            }
+            out_number(quantity);
+            out_append(" ", 1);
+            out_name(subject->items[i].name);
         }
-        printf("\n"); //print new line after all items are printed
+        out_append("\n", 1); //print new line after all items are printed
     } else {
         // print "NOTHING" if subject is not found
-        printf("NOTHING\n");
+        out_string("NOTHING\n");
         return 0;
     }
     return 0; //this may be unnecesary
@@ -380,9 +1485,10 @@ int print_location(char* name) {
     Subject *subject = get_subject(name);
     // print the location if subjects location is available, else print "NOWHERE"
     if (subject != NULL) {
-        printf("%s\n", subject->location_name);
+        out_name(subject->location_name);
+        out_append("\n", 1);
     } else {
-        printf("NOWHERE\n");
+        out_string("NOWHERE\n");
         return 0;
     }
     return 0;
@@ -393,25 +1499,299 @@ int print_people_at(char* location_name) {
     Location *location = get_location(location_name);
     // print "NOBODY" if location is not found
     if (location == NULL) {
-        printf("NOBODY\n");
+        out_string("NOBODY\n");
         return 0;
     }
     // print "NOBODY" if there are no subjects in location
     if (location->subject_count == 0) {
-        printf("NOBODY\n");
+        out_string("NOBODY\n");
         return 0;
     }
     // else, print subject names seperated with " and "
     for (int i = 0; i < location->subject_count; i++) {
         if (i != 0) {
-            printf(" and ");
+            out_append(" and ", 5);
+        }
+        out_name(world->subjects[location->subjects[i]].name);
+    }
+    out_append("\n", 1);
+    return 0;
+}
+
+// Function to print the holders of an item in rank order, used by "who has most" and "top" questions
+// if only_most is true, print just the names of the subjects tied at the top, otherwise print quantities and names of the first count holders
+int print_ranked_holders(ItemType *type, int count, bool only_most) {
+    // print "NOBODY" if nobody has the item
+    if (type == NULL || count <= 0 || type->heap_size == 0 || type->quantity[type->heap[0]] == 0) {
+        out_string("NOBODY\n");
+        return 0;
+    }
+    long long most = type->quantity[type->heap[0]];
+
+    // walk the heap in rank order with a second heap of candidate positions, this costs O(count log count)
+    // the candidates are children of already printed positions, so there can be at most count + 1 of them
+    int candidates[MAX_SUBJECTS + 1];
+    int candidate_count = 0;
+    candidates[candidate_count++] = 0;
+
+    for (int printed = 0; printed < count && candidate_count > 0; printed++) {
+        // pop the best candidate
+        int pos = candidates[0];
+        candidates[0] = candidates[--candidate_count];
+        for (int i = 0; ; ) {
+            int best = i;
+            int left = 2 * i + 1;
+            int right = 2 * i + 2;
+            if (left < candidate_count && ranks_before(type, type->heap[candidates[left]], type->heap[candidates[best]])) {
+                best = left;
+            }
+            if (right < candidate_count && ranks_before(type, type->heap[candidates[right]], type->heap[candidates[best]])) {
+                best = right;
+            }
+            if (best == i) {
+                break;
+            }
+            int temp = candidates[i];
+            candidates[i] = candidates[best];
+            candidates[best] = temp;
+            i = best;
+        }
+
+        int subject_index = type->heap[pos];
+        long long quantity = type->quantity[subject_index];
+        // the holders are popped in rank order, stop at the first one that does not hold the item (or holds less than the most)
+        if (quantity == 0 || (only_most && quantity != most)) {
+            break;
+        }
+        if (printed != 0) {
+            out_append(" and ", 5);
+        }
+        if (!only_most) {
+            out_number(quantity);
+            out_append(" ", 1);
+        }
+        out_name(world->subjects[subject_index].name);
+
+        // push the children of the popped position as new candidates
+        for (int child = 2 * pos + 1; child <= 2 * pos + 2 && child < type->heap_size; child++) {
+            int i = candidate_count++;
+            candidates[i] = child;
+            while (i > 0 && ranks_before(type, type->heap[candidates[i]], type->heap[candidates[(i - 1) / 2]])) {
+                int temp = candidates[i];
+                candidates[i] = candidates[(i - 1) / 2];
+                candidates[(i - 1) / 2] = temp;
+                i = (i - 1) / 2;
+            }
+        }
+    }
+    out_append("\n", 1);
+    return 0;
+}
+
+// Function to print the subjects that hold the most of an item, ties are printed seperated with " and "
+int print_most_holders(char* item_name) {
+    ItemType *type = get_item_type(item_name);
+    return print_ranked_holders(type, type == NULL ? 0 : type->heap_size, true);
+}
+
+// Function to print the top holders of an item with their quantities, seperated with " and "
+int print_top_holders(int count, char* item_name) {
+    return print_ranked_holders(get_item_type(item_name), count, false);
+}
+
+// Function to sum the quantity column of an item type for all subjects
+// the loop runs over the whole fixed size column (unused subjects hold 0) with a constant trip count, so the compiler turns it into a vector reduction
+long long sum_quantity_column(ItemType *type) {
+    long long sum = 0;
+    for (int i = 0; i < MAX_SUBJECTS; i++) {
+        sum += type->quantity[i];
+    }
+    return sum;
+}
+
+// Function to compare the quantity column of an item type with a quantity for all subjects, the result of each comparison (1 or 0) is written to matches
+// like sum_quantity_column, the loop has no branches and a constant trip count, so it is vectorized. quantities are never negative, so
+// "a > b" is the sign bit of the unsigned difference b - a, which needs only a subtraction and a shift that every SIMD unit has
+void compare_quantity_column(ItemType *type, bool more, long long comparison_quantity, long long *restrict matches) {
+    unsigned long long comparison = comparison_quantity;
+    if (more) {
+        for (int i = 0; i < MAX_SUBJECTS; i++) {
+            matches[i] = (comparison - (unsigned long long)type->quantity[i]) >> 63;
+        }
+    } else {
+        for (int i = 0; i < MAX_SUBJECTS; i++) {
+            matches[i] = ((unsigned long long)type->quantity[i] - comparison) >> 63;
+        }
+    }
+}
+
+// Function to print the total quantity of an item in the whole world
+int print_world_total(char* item_name) {
+    ItemType *type = get_item_type(item_name);
+    // if nobody ever had the item, the total is 0
+    out_number(type == NULL ? 0 : sum_quantity_column(type));
+    out_append("\n", 1);
+    return 0;
+}
+
+// Function to print the subjects that have more (or less) than a quantity of an item, seperated with " and "
+int print_holders_compared(char* item_name, bool more, long long comparison_quantity) {
+    ItemType *type = get_item_type(item_name);
+    long long matches[MAX_SUBJECTS];
+    if (type != NULL) {
+        compare_quantity_column(type, more, comparison_quantity, matches);
+    } else {
+        // if nobody ever had the item, everybody has 0 of it
+        for (int i = 0; i < MAX_SUBJECTS; i++) {
+            matches[i] = more ? 0 > comparison_quantity : 0 < comparison_quantity;
+        }
+    }
+
+    int printed = 0;
+    for (int i = 0; i < world->num_subjects; i++) {
+        if (!matches[i]) {
+            continue;
+        }
+        if (printed++ != 0) {
+            out_append(" and ", 5);
+        }
+        out_name(world->subjects[i].name);
+    }
+    // print "NOBODY" if no subject matches
+    if (printed == 0) {
+        out_string("NOBODY");
+    }
+    out_append("\n", 1);
+    return 0;
+}
+
+// Function to print the memory used by every subsystem, and the item slots and locations that hold nothing
+// item slots with 0 quantity wait for compaction and locations that everybody left are never removed, so both can pile up
+// the memory counters are for the whole process, only the item slots and locations are for the world that is read
+int print_memory() {
+    for (int i = 0; i <= MEMORY_KINDS && print_memory_counters; i++) {
+        out_printf("%s: %lld bytes (peak %lld)\n", i == MEMORY_KINDS ? "total" : memory_kind_names[i], atomic_load(&memory_used[i]), atomic_load(&memory_peak[i]));
+    }
+    int item_slots = 0;
+    int zero_items = 0;
+    for (int i = 0; i < world->num_subjects; i++) {
+        item_slots += world->subjects[i].item_count;
+        zero_items += world->subjects[i].zero_count;
+    }
+    int empty_locations = 0;
+    for (int i = 0; i < world->num_locations; i++) {
+        if (world->locations[i].subject_count == 0) {
+            empty_locations++;
         }
-        printf("%s", location->subjects[i]->name);
     }
-    printf("\n");
+    out_printf("items with 0 quantity: %d of %d\n", zero_items, item_slots);
+    out_printf("locations with nobody: %d of %d\n", empty_locations, world->num_locations);
     return 0;
 }
 
+// Kinds of questions that are cached
+#define CACHED_WHERE 1 // Subject where ? -- keyed by the subject
+#define CACHED_WHO_AT 2 // who at Location ? -- keyed by the location
+#define CACHED_TOTAL 3 // Subject total ? -- keyed by the subject
+#define CACHED_TOTAL_ITEM 4 // Subject(s) total Item ? -- keyed by the subjects and the item name
+
+// Struct for the key of a cached answer, questions are keyed by the resolved subject and location indices, not by their text
+typedef struct {
+    int kind;
+    int key_count; // number of indices in keys
+    int keys[CACHE_MAX_SUBJECTS]; // subject indices, or the location index for "who at"
+    unsigned int item; // item name id for "total Item" questions
+} CacheKey;
+
+// Struct for a cached answer, it is valid as long as the versions of its subjects (or location) did not change
+typedef struct {
+    CacheKey key; // kind is 0 for empty entries
+    unsigned int versions[CACHE_MAX_SUBJECTS]; // versions of the subjects (or location) when the answer was cached
+    char *answer; // formatted answer, including the new line
+    size_t answer_length;
+} CachedAnswer;
+
+// answers are cached in a direct-mapped table, an entry is replaced when another question maps to the same place
+// every thread has its own cache, an entry cached from an older version is not valid in a newer one since the versions differ
+_Thread_local CachedAnswer answer_cache[CACHE_SIZE];
+_Thread_local bool reading_past = false; // true while answering a question about the past, which is not cached
+
+// Function to get the current version of the i-th index of a key
+unsigned int current_version(CacheKey *key, int i) {
+    if (key->kind == CACHED_WHO_AT) {
+        return world->locations[key->keys[i]].version;
+    }
+    return world->subjects[key->keys[i]].version;
+}
+
+// Function to find the place of a key in the answer cache
+CachedAnswer* cache_entry(CacheKey *key) {
+    unsigned int hash = 2166136261u * (key->kind + 1) ^ key->item;
+    for (int i = 0; i < key->key_count; i++) {
+        hash = (hash ^ key->keys[i]) * 16777619u;
+    }
+    return &answer_cache[hash & (CACHE_SIZE - 1)];
+}
+
+// Function to print the cached answer of a question, returns false if there is no valid answer in the cache
+bool answer_from_cache(CacheKey *key) {
+    if (reading_past) {
+        return false;
+    }
+    CachedAnswer *entry = cache_entry(key);
+    // the entry should be for the same question
+    if (entry->key.kind != key->kind || entry->key.key_count != key->key_count || entry->key.item != key->item) {
+        return false;
+    }
+    for (int i = 0; i < key->key_count; i++) {
+        if (entry->key.keys[i] != key->keys[i]) {
+            return false;
+        }
+    }
+    // and nothing it depends on should have changed since it is cached
+    for (int i = 0; i < key->key_count; i++) {
+        if (entry->versions[i] != current_version(key, i)) {
+            return false;
+        }
+    }
+    out_append(entry->answer, entry->answer_length);
+    return true;
+}
+
+// Function to drop all cached answers of the thread
+void clear_answer_cache() {
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        answer_cache[i].key.kind = 0;
+    }
+}
+
+// Function to free the cached answers of the thread, before the thread exits
+void free_answer_cache() {
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        count_memory(MEMORY_CACHES, -(long long)answer_cache[i].answer_length);
+        free(answer_cache[i].answer);
+        answer_cache[i].answer = NULL;
+        answer_cache[i].answer_length = 0;
+        answer_cache[i].key.kind = 0;
+    }
+}
+
+// Function to cache the answer of a question, the answer is the output written since answer_start
+void cache_answer(CacheKey *key, size_t answer_start) {
+    if (reading_past) {
+        return;
+    }
+    CachedAnswer *entry = cache_entry(key);
+    entry->key = *key;
+    for (int i = 0; i < key->key_count; i++) {
+        entry->versions[i] = current_version(key, i);
+    }
+    count_memory(MEMORY_CACHES, (long long)(output_size - answer_start) - (long long)entry->answer_length);
+    entry->answer_length = output_size - answer_start;
+    entry->answer = realloc(entry->answer, entry->answer_length);
+    memcpy(entry->answer, output_buffer + answer_start, entry->answer_length);
+}
+
 //
 // 6. Input controlling functions and data types
 //
@@ -533,6 +1913,9 @@ bool initial_valid_check(char **tokens, int token_count) {
                 if(strcmp(tokens[i], "at") == 0 && strcmp(tokens[i - 1], "who") == 0) {
                     continue;
                 }
+                if(i > 0 && strcmp(tokens[i], "has") == 0 && strcmp(tokens[i - 1], "who") == 0) {
+                    continue;
+                }
                 // other than these, no keywords can follow other
                 if (keyword_flag != 0) {
                     return false;
@@ -551,6 +1934,10 @@ bool initial_valid_check(char **tokens, int token_count) {
                 }
             }
         } else {
+            // "who has most Item ?" is the only place that two names can follow each other, the item name is checked while answering
+            if (i >= 3 && strcmp(tokens[i - 1], "most") == 0 && strcmp(tokens[i - 2], "has") == 0 && strcmp(tokens[i - 3], "who") == 0) {
+                continue;
+            }
             // If two names that are not keyword nor number follow each other, the sentence is invalid
             if (i != 0 && keyword_flag == 0 && number_flag == 0 && strcmp(tokens[i], "?") != 0) {
                 return false;
@@ -580,12 +1967,17 @@ char** parse_sentence(char *input, int *token_count) {
 
     char **tokens = malloc(MAX_TOKENS * sizeof(char*)); // Allocate memory for pointers to tokens
     *token_count = 0; //initialize token count
-    char *token = strtok(input, " "); //tokenize the input with " "
+    char *position; // strtok_r keeps its position here so threads can parse at the same time
+    char *token = strtok_r(input, " ", &position); //tokenize the input with " "
 
     while (token != NULL && *token_count < MAX_TOKENS) {
         tokens[*token_count] = strdup(token); // Duplicate token and store it
         (*token_count)++; //increment the token count
-        token = strtok(NULL, " "); // and continue
+        token = strtok_r(NULL, " ", &position); // and continue
+    }
+    // the checks may look a few words past the end, they should see empty words there
+    for (int i = *token_count; i < MAX_TOKENS; i++) {
+        tokens[i] = "";
     }
     // return the pointer
     return tokens;
@@ -1033,48 +2425,187 @@ char** split_conditions(char** tokens, int token_count, int *start_index, int *w
 // 8. Main 
 //
 
-int main() {
-    char input[MAX_INPUT_LENGTH];
+// Function to execute one line of input and collect its answer in the output buffer, returns false if the line is "exit"
+bool run_command(char *input) {
+    store->command_time++;
+    return execute_line(input);
+}
 
-    while (true) {
-        printf(">> "); 
-        fflush(stdout);
-        fgets(input, MAX_INPUT_LENGTH, stdin); // read the input
+// Function to check if a question is about the world after a command, "... at time N ?"
+bool is_past_question(char **tokens, int token_count) {
+    return token_count >= 6 && strcmp(tokens[token_count - 1], "?") == 0 && strcmp(tokens[token_count - 4], "at") == 0 && strcmp(tokens[token_count - 3], "time") == 0 && is_numeric_string(tokens[token_count - 2]);
+}
 
-        // Remove trailing newline character
-        input[strcspn(input, "\n")] = '\0';
+// Function to execute one line of input without counting it as a command, readers that share a store ask their questions with it
+bool execute_line(char *input) {
+    // Remove trailing newline character
+    input[strcspn(input, "\n")] = '\0';
 
-        // Check for exit command, break if input is exit
-        if (strcmp(input, "exit") == 0) {
-            break;
+    // Check for exit command, return false if input is exit
+    if (strcmp(input, "exit") == 0) {
+        return false;
+    }
+    trace_begin("command");
+    
+    int token_count = 0; // initialize token count to 0
+    // parse the sentence into tokens
+    trace_begin("parse_sentence");
+    char **tokens = parse_sentence(input, &token_count);
+    trace_end("parse_sentence");
+
+    // Question at time N? -- the question is asked about the world after the N-th command, remove "at time N" and check the question as usual
+    long long past_time = -1;
+    if (is_past_question(tokens, token_count)) {
+        past_time = parse_number(tokens[token_count - 2], QUANTITY_MAX);
+        for (int i = token_count - 4; i < token_count - 1; i++) {
+            free(tokens[i]);
         }
-        
-        int token_count = 0; // initialize token count to 0
-        // parse the sentence into tokens
-        char **tokens = parse_sentence(input, &token_count);
+        tokens[token_count - 4] = tokens[token_count - 1];
+        token_count -= 3;
+    }
 
-        // do an initial valid check
-        if (!initial_valid_check(tokens, token_count)) {
-            printf("INVALID\n");
-            continue;
+    // do an initial valid check
+    trace_begin("initial_valid_check");
+    bool valid = initial_valid_check(tokens, token_count);
+    trace_end("initial_valid_check");
+    if (!valid) {
+        out_string("INVALID\n");
+        free_tokens(tokens, token_count);
+        trace_end("command");
+        return true;
+    }
+    // Determine if input is a sentence or question, if it is a question, answer it, otherwise execute the sentence. Print "INVALID" if input is invalid.
+    // a question reads the latest published version, a sentence writes a new version that is published even if it is invalid
+    // (the actions before the invalid part are kept, as before)
+    if (strcmp(tokens[token_count - 1], "?") == 0) {
+        pin_world();
+        char *step = past_time == -1 ? "answer_question" : "answer_question_at";
+        trace_begin(step);
+        int result = past_time == -1 ? answer_question(tokens, token_count) : answer_question_at(tokens, token_count, past_time);
+        trace_end(step);
+        unpin_world();
+        if(result == -1) {
+            out_string("INVALID\n");
         }
-        // Determine if input is a sentence or question, if it is a question, answer it, otherwise execute the sentence. Print "INVALID" if input is invalid.
-        if (strcmp(tokens[token_count - 1], "?") == 0) {
-            if(answer_question(tokens, token_count) == -1) {
-                printf("INVALID\n");
-                continue;
+    } else {
+        begin_write();
+        int result = execute_sentences(tokens, token_count);
+        publish_write();
+        if (result == -1) {
+            out_string("INVALID\n");
+        } else {
+            out_string("OK\n"); // if the sentence is not invalid, print "OK"
+        }
+    }
+    free_tokens(tokens, token_count);
+    trace_end("command");
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    char input[MAX_INPUT_LENGTH];
+    char *export_path = NULL; // file to export the world to when the program exits
+    char *record_path = NULL; // file to record the commands and answers to
+    char *replay_path = NULL; // file to replay instead of reading commands
+    char *test_directory = NULL; // directory of test cases to run instead of reading commands
+    char *trace_path = NULL; // file to write the trace to when the program exits
+    int thread_count = sysconf(_SC_NPROCESSORS_ONLN); // threads to run the test cases on
+    int reader_count = 0; // threads that share the store of every test case
+    bind_store(create_store());
+    setup_ring();
+
+    // ringmaster [--import FILE]... [--export FILE] [--record FILE | --replay FILE] [--trace FILE]
+    // ringmaster --test DIRECTORY [--threads N] [--readers N] [--trace FILE]
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--import") == 0 && i + 1 < argc) {
+            if (import_file(argv[++i]) == -1) {
+                fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[i]);
+                return 1;
             }
+        } else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            export_path = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc && replay_path == NULL) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc && record_path == NULL) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--test") == 0 && i + 1 < argc) {
+            test_directory = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && is_numeric_string(argv[i + 1])) {
+            thread_count = parse_number(argv[++i], INT_MAX);
+        } else if (strcmp(argv[i], "--readers") == 0 && i + 1 < argc && is_numeric_string(argv[i + 1])) {
+            reader_count = parse_number(argv[++i], INT_MAX);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+            tracing = true;
+            trace_start = now_ns();
         } else {
-            if (execute_sentences(tokens, token_count) == -1) {
-                printf("INVALID\n");
-                continue;
-            } else {
-                printf("OK\n"); // if the sentence is not invalid, print "OK" and continue
-                continue;
+            fprintf(stderr, "usage: %s [--import FILE]... [--export FILE] [--record FILE | --replay FILE] [--trace FILE]\n", argv[0]);
+            fprintf(stderr, "       %s --test DIRECTORY [--threads N] [--readers N] [--trace FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int status = 0;
+    if (test_directory != NULL) {
+        // run the test cases, every case has its own store
+        status = run_tests(test_directory, thread_count, reader_count);
+        if (status == -1) {
+            fprintf(stderr, "%s: no test cases in %s\n", argv[0], test_directory);
+            return 1;
+        }
+    } else if (replay_path != NULL) {
+        // replay a recorded log, check the answers and compare the timings with the recording
+        status = replay_log(replay_path);
+        if (status == -1) {
+            fprintf(stderr, "%s: cannot replay %s\n", argv[0], replay_path);
+            return 1;
+        }
+    } else {
+        FILE *record = NULL;
+        if (record_path != NULL && (record = start_recording(record_path)) == NULL) {
+            fprintf(stderr, "%s: cannot write %s\n", argv[0], record_path);
+            return 1;
+        }
+        while (true) {
+            out_string(">> "); 
+            // read the input, the output is written when the input has to be waited for, stop at the end of the input
+            if (read_input_line(input, MAX_INPUT_LENGTH) == NULL) {
+                break;
+            }
+            // the answer of the command is the output after the prompt, run_command changes the input so the recorded line is copied first
+            size_t answer_start = output_size;
+            char line[MAX_INPUT_LENGTH];
+            long long start_time = 0;
+            if (record != NULL) {
+                strcpy(line, input);
+                start_time = now_ns();
+            }
+            bool go_on = run_command(input);
+            if (record != NULL) {
+                record_command(record, line, start_time, now_ns() - start_time, answer_start);
+            }
+            if (!go_on) {
+                break;
             }
-        }               
+        }
+        if (record != NULL && fclose(record) != 0) {
+            fprintf(stderr, "%s: cannot write %s\n", argv[0], record_path);
+            status = 1;
+        }
     }
-    return 0;
+    finish_output();
+
+    // export the world and write the trace if asked
+    if (export_path != NULL && export_file(export_path) == -1) {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], export_path);
+        return 1;
+    }
+    if (trace_path != NULL && write_trace(trace_path) == -1) {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], trace_path);
+        return 1;
+    }
+    free_past_world();
+    return status;
 }
 
 //
@@ -1105,20 +2636,26 @@ int execute_sentences(char **tokens, int token_count) {
 
                 // condition check
                 int condition_wc = 0; // word count
+                trace_begin("split_conditions");
                 char **condition_sentence = split_conditions(tokens, token_count, &if_start_index, &condition_wc); // split the first condition sentence
+                trace_end("split_conditions");
 
                 if (condition_sentence == NULL) { // if condition sentence is NULL, than there is an invalidation, return -1
                     return -1;
                 }
                 
-                if (condition_check(condition_sentence, condition_wc) == -1) {
+                trace_begin("condition_check");
+                int condition_result = condition_check(condition_sentence, condition_wc);
+                trace_end("condition_check");
+                if (condition_result == -1) {
                     // if condition is not satisfied, adjust the flag, free allocated memory and continue to traverse other sentences
+                    // (only the array is freed, the words belong to tokens and are freed by run_command)
                     conditionflag = 0;
-                    free_tokens(condition_sentence, condition_wc);
+                    free(condition_sentence);
                     continue;
                 }
                 // if condition is satisfied, just free allocated memory, let flag be the same
-                free_tokens(condition_sentence, condition_wc);
+                free(condition_sentence);
             }
 
             if (conditionflag == 0) { // if conditions are not satisfied, adjust the start index to point next sentence and continue the loop
@@ -1129,18 +2666,23 @@ int execute_sentences(char **tokens, int token_count) {
             // if all conditions are satisfied, than execute the actions
             while (start_index < if_index) {
                 int word_count = 0;
+                trace_begin("split_actions");
                 char **action_sentence = split_actions(tokens, token_count, &start_index, &word_count); // split the first action sentence
+                trace_end("split_actions");
 
                 if (action_sentence == NULL) { // if action sentence is NULL, than there is an invalidation, return -1
                     return -1;
                 }
                 // execute the action
-                if (execute_action(action_sentence, word_count) == -1) { // if there is a problem, free allocated memory and return -1
-                    free_tokens(action_sentence, word_count);
+                trace_begin("execute_action");
+                int action_result = execute_action(action_sentence, word_count);
+                trace_end("execute_action");
+                if (action_result == -1) { // if there is a problem, free allocated memory and return -1
+                    free(action_sentence);
                     return -1;
                 }
                 // if action is executed without problem, free allocated memory
-                free_tokens(action_sentence, word_count);
+                free(action_sentence);
             }
             start_index = if_start_index; // after executing the if sentence, adjust the start index to point the next sentence
 
@@ -1149,18 +2691,23 @@ int execute_sentences(char **tokens, int token_count) {
             while (start_index < token_count) {
             
                 int word_count = 0;
+                trace_begin("split_actions");
                 char **action_sentence = split_actions(tokens, token_count, &start_index, &word_count); // split the first action sentence
+                trace_end("split_actions");
 
                 if (action_sentence == NULL) { // if action sentence is NULL, than there is an invalidation, return -1
                     return -1;
                 }
                 // execute the action
-                if (execute_action(action_sentence, word_count) == -1) { // if there is a problem, free allocated memory and return -1
-                    free_tokens(action_sentence, word_count);
+                trace_begin("execute_action");
+                int action_result = execute_action(action_sentence, word_count);
+                trace_end("execute_action");
+                if (action_result == -1) { // if there is a problem, free allocated memory and return -1
+                    free(action_sentence);
                     return -1;
                 }
                 // if action is executed without problem, free allocated memory
-                free_tokens(action_sentence, word_count);
+                free(action_sentence);
             }
         }
     }
@@ -1193,7 +2740,7 @@ int execute_action(char** action_sentence, int word_count) {
                     if (strcmp(action_sentence[i], "and") == 0) {
                             continue;
                     }
-                    if (get_subject_item_quantity(action_sentence[word_count - 1], action_sentence[i + 1]) >= atoi(action_sentence[i])) {
+                    if (get_subject_item_quantity(action_sentence[word_count - 1], action_sentence[i + 1]) >= parse_number(action_sentence[i], QUANTITY_MAX)) {
                         i++;
                     } else {
                         return 0; // it is not invalid, just no action is executed
@@ -1215,7 +2762,7 @@ int execute_action(char** action_sentence, int word_count) {
                             continue;
                         }
                         // buyer buy the item from seller, return -1 if there is a problem
-                        if (buy_from(buyer_subject, seller_subject, action_sentence[j + 1], atoi(action_sentence[j])) == -1) {
+                        if (buy_from(buyer_subject, seller_subject, action_sentence[j + 1], parse_number(action_sentence[j], QUANTITY_MAX)) == -1) {
                             return -1;
                         }
                         // increment j to skip the second word (name) of item
@@ -1238,7 +2785,7 @@ int execute_action(char** action_sentence, int word_count) {
                             continue;
                         }
                         // buyer buy the item from an infinite source, return -1 if there is a problem
-                        if (add_item_to_subject(buyer_subject, action_sentence[j + 1], atoi(action_sentence[j])) == -1) {
+                        if (add_item_to_subject(buyer_subject, action_sentence[j + 1], parse_number(action_sentence[j], QUANTITY_MAX)) == -1) {
                             return -1;
                         }
                         // increment j to skip the second word (name) of item
@@ -1263,7 +2810,7 @@ int execute_action(char** action_sentence, int word_count) {
                         if (strcmp(action_sentence[j], "and") == 0) {
                                 continue;
                         }
-                        if (get_subject_item_quantity(action_sentence[i], action_sentence[j + 1]) >= atoi(action_sentence[j])) {
+                        if (get_subject_item_quantity(action_sentence[i], action_sentence[j + 1]) >= parse_number(action_sentence[j], QUANTITY_MAX)) {
                             // if there are enough items, continue
                             j++;
                         } else {
@@ -1293,7 +2840,7 @@ int execute_action(char** action_sentence, int word_count) {
                             continue;
                         }
                         // buyer buys the item from seller, return -1 if there is a problem
-                        if (buy_from(buyer_subject, seller_subject, action_sentence[j + 1], atoi(action_sentence[j])) == -1) {
+                        if (buy_from(buyer_subject, seller_subject, action_sentence[j + 1], parse_number(action_sentence[j], QUANTITY_MAX)) == -1) {
                             return -1;
                         }
                         // increment j to skip the second word (name) of item
@@ -1310,7 +2857,7 @@ int execute_action(char** action_sentence, int word_count) {
                         if (strcmp(action_sentence[j], "and") == 0) {
                                 continue;
                         }
-                        if (get_subject_item_quantity(action_sentence[i], action_sentence[j + 1]) >= atoi(action_sentence[j])) {
+                        if (get_subject_item_quantity(action_sentence[i], action_sentence[j + 1]) >= parse_number(action_sentence[j], QUANTITY_MAX)) {
                             j++;
                         } else {
                             return 0; // it is not invalid, just no action is executed
@@ -1333,7 +2880,7 @@ int execute_action(char** action_sentence, int word_count) {
                             continue;
                         }
                         // seller sell the item to an infite source, return -1 if there is a problem
-                        if (subtract_item_from_subject(seller_subject, action_sentence[j + 1], atoi(action_sentence[j])) == -1) {
+                        if (subtract_item_from_subject(seller_subject, action_sentence[j + 1], parse_number(action_sentence[j], QUANTITY_MAX)) == -1) {
                             return -1;
                         }
                         // increment j to skip the second word (name) of item
@@ -1398,7 +2945,7 @@ int condition_check(char** condition_sentence, int word_count) {
                 if (subject == NULL) {
                     return -1;
                 }
-                if (strcmp(subject->location_name, location->name) != 0) {
+                if (subject->location_name != location->name) {
                     return -1;
                 }
             }
@@ -1424,13 +2971,14 @@ int condition_check(char** condition_sentence, int word_count) {
                         if (strcmp(condition_sentence[j], "and") == 0) {
                             continue;
                         }
-                        int comparison_quantity = atoi(condition_sentence[j]);
+                        long long comparison_quantity = parse_number(condition_sentence[j], QUANTITY_MAX);
                         Item *item = get_item_of_subject(condition_sentence[j+1], subject);
                         if (item == NULL) {
-                            // since it says less than, return 0 (it is valid)
+                            // since it says less than, return 0 (it is valid), skip the item name too
+                            j++;
                             continue;
                         }
-                        if (item->quantity >= comparison_quantity) {
+                        if (item_quantity(item, subject) >= comparison_quantity) {
                             // if subject has more or equal, return -1
                             return -1;
                         }
@@ -1455,12 +3003,12 @@ int condition_check(char** condition_sentence, int word_count) {
                         if (strcmp(condition_sentence[j], "and") == 0) {
                             continue;
                         }
-                        int comparison_quantity = atoi(condition_sentence[j]);
+                        long long comparison_quantity = parse_number(condition_sentence[j], QUANTITY_MAX);
                         Item *item = get_item_of_subject(condition_sentence[j+1], subject);
                         if (item == NULL) {
                             return -1;
                         }
-                        if (item->quantity <= comparison_quantity) {
+                        if (item_quantity(item, subject) <= comparison_quantity) {
                             // if subject has less or equal, return -1
                             return -1;
                         }
@@ -1484,7 +3032,7 @@ int condition_check(char** condition_sentence, int word_count) {
                         if (!is_numeric_string(condition_sentence[j])) {
                             continue;
                         }
-                        int comparison_quantity = atoi(condition_sentence[j]);
+                        long long comparison_quantity = parse_number(condition_sentence[j], QUANTITY_MAX);
                         // if there is no subject, it counts as 0
                         if (subject == NULL) {
                             if (comparison_quantity == 0) {
@@ -1500,7 +3048,7 @@ int condition_check(char** condition_sentence, int word_count) {
                             }
                             return -1; 
                         }
-                        if (item->quantity != comparison_quantity) {
+                        if (item_quantity(item, subject) != comparison_quantity) {
                             // if subject has different amount of, return -1
                             return -1;
                         }
@@ -1524,6 +3072,26 @@ int answer_question(char **tokens, int token_count) {
     // assign start index to first word of the input
     int start_index = 0;
     int index;
+
+    // top N Item? -- "top" is not a keyword, so check it before searching the question words
+    if (token_count == 4 && strcmp(tokens[0], "top") == 0 && is_numeric_string(tokens[1])) {
+        // if the item word is not valid, the question is invalid return -1
+        if (!is_valid_word(tokens[2]) || strcmp(tokens[3], "?") != 0) {
+            return -1;
+        }
+        // print the top holders if all things fine, there can not be more holders than MAX_SUBJECTS
+        long long count = parse_number(tokens[1], QUANTITY_MAX);
+        if (print_top_holders(count > MAX_SUBJECTS ? MAX_SUBJECTS : count, tokens[2]) == -1) {
+            return -1;
+        }
+        return 0;
+    }
+
+    // memory? -- "memory" is not a keyword either
+    if (token_count == 2 && strcmp(tokens[0], "memory") == 0 && strcmp(tokens[1], "?") == 0) {
+        return print_memory();
+    }
+
     index = get_questionword_index(tokens, token_count, start_index);
 
     if (index != -1) {
@@ -1546,10 +3114,21 @@ int answer_question(char **tokens, int token_count) {
                     return -1;
                 }
 
+                // answer from the cache if the subject did not change since the last time it is asked
+                Subject *subject = get_subject(tokens[0]);
+                CacheKey key = {CACHED_TOTAL, 1, {subject == NULL ? -1 : subject - world->subjects}, 0};
+                if (subject != NULL && answer_from_cache(&key)) {
+                    return 0;
+                }
+
                 // if everything is fine, print the items and return
+                size_t answer_start = output_size;
                 if (print_all_items(tokens[index - 1]) == -1) {
                     return -1;
                 }
+                if (subject != NULL) {
+                    cache_answer(&key, answer_start);
+                }
                 return 0;
             } 
 
@@ -1564,8 +3143,18 @@ int answer_question(char **tokens, int token_count) {
                 return -1;
             }
 
+            // total Item? -- if there are no subjects before "total", print the total of the whole world
+            if (index == 0) {
+                if (print_world_total(tokens[item_index]) == -1) {
+                    return -1;
+                }
+                return 0;
+            }
+
             // if there is no problem with the right side of "total", continue
-            int total = 0; // initialize total amount
+            // the answer can be cached if the item and all the subjects exist and there are not too many subjects
+            CacheKey key = {CACHED_TOTAL_ITEM, 0, {0}, 0};
+            bool cacheable = find_name(tokens[item_index], &key.item);
             for(int i = 0; i < index; i++) {
                 // If the word is "and", not a subject, continue, first and last words cannot be "and"
                 if (strcmp(tokens[i], "and") == 0 && i != 0 && i != index - 1) {
@@ -1579,12 +3168,33 @@ int answer_question(char **tokens, int token_count) {
                     if (!is_valid_word(tokens[i])) {
                         return -1;
                     } 
-                    // if there are no problems, add the item quantity of subject to total
+                    Subject *subject = get_subject(tokens[i]);
+                    if (subject == NULL || key.key_count == CACHE_MAX_SUBJECTS) {
+                        cacheable = false;
+                    } else {
+                        key.keys[key.key_count++] = subject - world->subjects;
+                    }
+                }
+            }
+            // answer from the cache if none of the subjects changed since the last time it is asked
+            if (cacheable && answer_from_cache(&key)) {
+                return 0;
+            }
+
+            // if there are no problems, add the item quantities of subjects to total
+            size_t answer_start = output_size;
+            long long total = 0; // initialize total amount
+            for(int i = 0; i < index; i++) {
+                if (strcmp(tokens[i], "and") != 0) {
                     total += get_subject_item_quantity(tokens[i], tokens[item_index]);
                 }
             }
             // print the total
-            printf("%d\n", total);
+            out_number(total);
+            out_append("\n", 1);
+            if (cacheable) {
+                cache_answer(&key, answer_start);
+            }
             return 0;
         }
 
@@ -1595,10 +3205,48 @@ int answer_question(char **tokens, int token_count) {
             if(token_count != 3 || !(is_valid_word(tokens[index - 1])) || index != 1 || strcmp(tokens[index +1], "?") != 0) {
                 return -1;
             }
+            // answer from the cache if the subject did not move since the last time it is asked
+            Subject *subject = get_subject(tokens[index - 1]);
+            CacheKey key = {CACHED_WHERE, 1, {subject == NULL ? -1 : subject - world->subjects}, 0};
+            if (subject != NULL && answer_from_cache(&key)) {
+                return 0;
+            }
             // print the location if all things fine
+            size_t answer_start = output_size;
             if (print_location(tokens[index - 1]) == -1) {
                 return -1;
             }
+            if (subject != NULL) {
+                cache_answer(&key, answer_start);
+            }
+            return 0;
+        }
+
+        // who has more than N Item? -- who has less than N Item?
+        if (strcmp(tokens[index], "who") == 0 && token_count > 3 && strcmp(tokens[index + 1], "has") == 0 && (strcmp(tokens[index + 2], "more") == 0 || strcmp(tokens[index + 2], "less") == 0)) {
+
+            // check possible invalidations, the format should be "who has more/less than N Item ?", also check if the quantity is a number and the item is a valid word
+            if(token_count != 7 || index != 0 || strcmp(tokens[index + 3], "than") != 0 || !is_numeric_string(tokens[index + 4]) || !(is_valid_word(tokens[index + 5])) || strcmp(tokens[index + 6], "?") != 0) {
+                return -1;
+            }
+            // print the subjects that match if all things fine
+            if (print_holders_compared(tokens[index + 5], strcmp(tokens[index + 2], "more") == 0, parse_number(tokens[index + 4], QUANTITY_MAX)) == -1) {
+                return -1;
+            }
+            return 0;
+        }
+
+        // who has most Item?
+        if (strcmp(tokens[index], "who") == 0 && index + 1 < token_count && strcmp(tokens[index + 1], "has") == 0) {
+
+            // check possible invalidations, the format should be "who has most Item ?", also check if the item is a valid word
+            if(token_count != 5 || index != 0 || strcmp(tokens[index + 2], "most") != 0 || !(is_valid_word(tokens[index + 3])) || strcmp(tokens[index + 4], "?") != 0) {
+                return -1;
+            }
+            // print the subjects that have the most of the item if all things fine
+            if (print_most_holders(tokens[index + 3]) == -1) {
+                return -1;
+            }
             return 0;
         }
 
@@ -1609,10 +3257,20 @@ int answer_question(char **tokens, int token_count) {
             if(token_count != 4 || strcmp(tokens[index + 1], "at") != 0 || !(is_valid_word(tokens[index + 2])) || index != 0 || strcmp(tokens[index + 3], "?") != 0) {
                 return -1;
             }
+            // answer from the cache if nobody arrived or left since the last time it is asked
+            Location *location = get_location(tokens[index + 2]);
+            CacheKey key = {CACHED_WHO_AT, 1, {location == NULL ? -1 : location - world->locations}, 0};
+            if (location != NULL && answer_from_cache(&key)) {
+                return 0;
+            }
             // print the people at location if all things fine
+            size_t answer_start = output_size;
             if (print_people_at(tokens[index + 2]) == -1) {
                 return -1;
             }
+            if (location != NULL) {
+                cache_answer(&key, answer_start);
+            }
 
             return 0;
         }
@@ -1633,3 +3291,1133 @@ void free_tokens(char **tokens, int token_count) {
     free(tokens);
 }
 
+
+//
+// 10. Bulk import and export
+//
+
+// Rows of import and export files are either "Subject,Item,Quantity" or "Subject,Location", fields can also be seperated with tabs
+// imported rows are written straight into the tables, the indexes (sorted inventories and heaps) are built once at the end
+
+// Function to get a Subject while importing, create if it does not exist, returns NULL if the name is invalid or there is no space
+Subject* import_subject(char *name) {
+    Subject *subject = get_subject(name);
+    if (subject == NULL && is_valid_word(name)) {
+        subject = create_subject(name);
+    }
+    return subject;
+}
+
+// Function to find the Item of a Subject by its type with a linear scan, item_order is not sorted while importing
+Item* find_imported_item(Subject *subject, int type_id) {
+    for (int i = 0; i < subject->item_count; i++) {
+        if (subject->items[i].type_id == type_id) {
+            return &subject->items[i];
+        }
+    }
+    return NULL;
+}
+
+// Function to import one row, returns false if the row is invalid
+bool import_row(char *row) {
+    // split the row into at most 3 fields, the first ',' or tab decides the delimiter of the row
+    char *fields[3];
+    int field_count = 0;
+    char delimiter = row[strcspn(row, ",\t")];
+    fields[field_count++] = row;
+    for (char *c = row; *c != '\0'; c++) {
+        if (*c == delimiter) {
+            if (field_count == 3) {
+                return false;
+            }
+            *c = '\0';
+            fields[field_count++] = c + 1;
+        }
+    }
+    if (field_count < 2) {
+        return false;
+    }
+
+    Subject *subject = import_subject(fields[0]);
+    if (subject == NULL) {
+        return false;
+    }
+
+    // Subject,Location
+    if (field_count == 2) {
+        Location *location = get_location(fields[1]);
+        if (location == NULL && is_valid_word(fields[1])) {
+            location = create_location(fields[1]);
+        }
+        if (location == NULL) {
+            return false;
+        }
+        return change_location(subject, location) == 0;
+    }
+
+    // Subject,Item,Quantity
+    if (fields[2][0] == '\0' || !is_numeric_string(fields[2])) {
+        return false;
+    }
+    ItemType *type = get_item_type(fields[1]);
+    if (type == NULL && is_valid_word(fields[1])) {
+        type = create_item_type(fields[1]);
+    }
+    if (type == NULL) {
+        return false;
+    }
+    int type_id = type->id;
+    Item *item = find_imported_item(subject, type_id);
+
+    // the new quantity should not pass QUANTITY_MAX, the row is invalid if it does
+    long long quantity = parse_number(fields[2], QUANTITY_MAX);
+    long long old_quantity = item == NULL ? 0 : item_quantity(item, subject);
+    long long new_quantity;
+    if (__builtin_add_overflow(old_quantity, quantity, &new_quantity) || new_quantity > QUANTITY_MAX) {
+        return false;
+    }
+    if (item == NULL) {
+        // if the inventory is full, reclaim the slots of the items with 0 quantity
+        if (subject->item_count == MAX_ITEMS) {
+            compact_inventory(subject);
+            if (subject->item_count == MAX_ITEMS) {
+                return false;
+            }
+        }
+        // append the item, its place in item_order is fixed when the indexes are rebuilt
+        subject->item_order[subject->item_count] = subject->item_count;
+        item = &subject->items[subject->item_count++];
+        item->name = type->name;
+        item->type_id = type_id;
+        subject->zero_count++;
+    }
+
+    int subject_index = subject - world->subjects;
+    type = writable_item_type(type_id);
+    if (old_quantity == 0 && quantity > 0) {
+        subject->zero_count--;
+    }
+    type->quantity[subject_index] = new_quantity;
+    return true;
+}
+
+// Function to rebuild the indexes of all subjects and item types after an import
+void rebuild_indexes() {
+    for (int i = 0; i < world->num_subjects; i++) {
+        Subject *subject = &world->subjects[i];
+        // sort item_order by name id with insertion sort, inventories are small
+        for (int j = 1; j < subject->item_count; j++) {
+            int index = subject->item_order[j];
+            int k = j - 1;
+            while (k >= 0 && subject->items[subject->item_order[k]].name > subject->items[index].name) {
+                subject->item_order[k + 1] = subject->item_order[k];
+                k--;
+            }
+            subject->item_order[k + 1] = index;
+        }
+        // cached answers of the subject are not valid anymore
+        subject->version++;
+    }
+    for (int i = 0; i < world->num_item_types; i++) {
+        rebuild_heap(writable_item_type(i));
+    }
+}
+
+// Function to import the rows of a file, invalid rows are reported to stderr and skipped
+// returns -1 if the file cannot be read, otherwise the number of invalid rows
+int import_file(char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    // the whole file is imported as one new version
+    begin_write();
+    char *block = malloc(IMPORT_BLOCK_SIZE + 1);
+    size_t kept = 0; // bytes of an unfinished row kept from the previous block
+    long long line_number = 0;
+    int invalid_rows = 0;
+    while (true) {
+        size_t read = fread(block + kept, 1, IMPORT_BLOCK_SIZE - kept, file);
+        size_t length = kept + read;
+        bool last_block = read == 0;
+        if (last_block && length == 0) {
+            break;
+        }
+        // at the end of the file, the last row may not have a new line
+        if (last_block) {
+            block[length++] = '\n';
+        }
+
+        // import every complete row in the block
+        char *row = block;
+        char *end = block + length;
+        char *new_line;
+        while ((new_line = memchr(row, '\n', end - row)) != NULL) {
+            *new_line = '\0';
+            if (new_line > row && new_line[-1] == '\r') {
+                new_line[-1] = '\0';
+            }
+            line_number++;
+            if (*row != '\0' && !import_row(row)) {
+                fprintf(stderr, "%s:%lld: invalid row\n", path, line_number);
+                invalid_rows++;
+            }
+            row = new_line + 1;
+        }
+        if (last_block) {
+            break;
+        }
+
+        // keep the unfinished row for the next block, a row cannot be longer than a block
+        kept = end - row;
+        if (kept == IMPORT_BLOCK_SIZE) {
+            fprintf(stderr, "%s:%lld: row is too long\n", path, line_number + 1);
+            invalid_rows++;
+            break;
+        }
+        memmove(block, row, kept);
+    }
+
+    free(block);
+    fclose(file);
+    rebuild_indexes();
+    publish_write();
+    return invalid_rows;
+}
+
+// Function to export the inventories and locations of all subjects, in the same format as import_file reads
+// files ending with ".tsv" are seperated with tabs, others with commas. returns -1 if the file cannot be written
+int export_file(char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+    size_t path_length = strlen(path);
+    char delimiter = path_length >= 4 && strcmp(path + path_length - 4, ".tsv") == 0 ? '\t' : ',';
+    pin_world();
+
+    // inventories in the order the items are bought
+    for (int i = 0; i < world->num_subjects; i++) {
+        Subject *subject = &world->subjects[i];
+        for (int j = 0; j < subject->item_count; j++) {
+            long long quantity = item_quantity(&subject->items[j], subject);
+            if (quantity != 0) {
+                fprintf(file, "%s%c%s%c%lld\n", name_of(subject->name), delimiter, name_of(subject->items[j].name), delimiter, quantity);
+            }
+        }
+    }
+    // locations in the order the subjects arrived, so that "who at" answers the same after importing
+    for (int i = 0; i < world->num_locations; i++) {
+        for (int j = 0; j < world->locations[i].subject_count; j++) {
+            fprintf(file, "%s%c%s\n", name_of(world->subjects[world->locations[i].subjects[j]].name), delimiter, name_of(world->locations[i].name));
+        }
+    }
+
+    unpin_world();
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+
+//
+// 11. History of the world
+//
+
+// Every published version is compared with the previous one and the differences are kept as deltas, stamped with the
+// number of the command that made them (commands are numbered from 1 in the order they are read, imports are command 0)
+// a full copy of the world (keyframe) is kept every KEYFRAME_INTERVAL commands, so the world after any command can be
+// rebuilt from the nearest keyframe before it and the deltas of at most KEYFRAME_INTERVAL commands
+
+// Kinds of deltas
+#define DELTA_SUBJECT 1 // a subject is created or its inventory or location changed -- value is the index of the new Subject in subject_records
+#define DELTA_LOCATION 2 // a location is created or somebody arrived or left -- value is the index of the new Location in location_records
+#define DELTA_ITEM_TYPE 3 // an item type is created -- value is its name id
+#define DELTA_QUANTITY 4 // the quantity of an item of a subject changed -- value is the new quantity
+
+// Struct for a change of the world made by a command
+typedef struct {
+    long long time; // number of the command that made the change
+    int kind;
+    int index; // subject, location or item type index
+    int subject_index; // subject index of DELTA_QUANTITY
+    long long value; // new quantity of DELTA_QUANTITY, record index of DELTA_SUBJECT and DELTA_LOCATION, name id of DELTA_ITEM_TYPE
+} Delta;
+
+// Struct for a full copy of the world after a command
+typedef struct {
+    long long time; // the world after this command
+    size_t first_delta; // index of the first delta made after the keyframe
+    World *world; // item_types point to types below
+    ItemType *types;
+} Keyframe;
+
+// Struct for the history of the world of a store
+struct History {
+    Delta *deltas;
+    size_t delta_count;
+    size_t delta_capacity;
+    Subject *subject_records; // new Subject structs of DELTA_SUBJECT deltas
+    size_t subject_record_count;
+    size_t subject_record_capacity;
+    Location *location_records; // new Location structs of DELTA_LOCATION deltas
+    size_t location_record_count;
+    size_t location_record_capacity;
+    Keyframe *keyframes;
+    size_t keyframe_count;
+    size_t keyframe_capacity;
+    long long last_delta_time; // time of the last recorded delta
+    pthread_mutex_t lock; // the history is written by writers and read by questions about the past
+};
+
+// Function to create an empty history
+History* create_history() {
+    History *history = calloc(1, sizeof(History));
+    history->last_delta_time = -1;
+    pthread_mutex_init(&history->lock, NULL);
+    return history;
+}
+
+// Function to free a history and everything in it
+void free_history(History *history) {
+    for (size_t i = 0; i < history->keyframe_count; i++) {
+        count_memory(MEMORY_HISTORY, -(long long)(sizeof(World) + (history->keyframes[i].world->num_item_types + 1) * sizeof(ItemType)));
+        free(history->keyframes[i].world);
+        free(history->keyframes[i].types);
+    }
+    count_memory(MEMORY_HISTORY, -(long long)(history->delta_capacity * sizeof(Delta) + history->subject_record_capacity * sizeof(Subject)
+                                              + history->location_record_capacity * sizeof(Location) + history->keyframe_capacity * sizeof(Keyframe)));
+    free(history->deltas);
+    free(history->subject_records);
+    free(history->location_records);
+    free(history->keyframes);
+    pthread_mutex_destroy(&history->lock);
+    free(history);
+}
+
+// the world rebuilt for a question about the past, every thread has its own
+_Thread_local World *past_world = NULL;
+_Thread_local ItemType *past_types = NULL;
+
+// Function to free the past world of the thread, before the thread exits
+void free_past_world() {
+    if (past_world != NULL) {
+        count_memory(MEMORY_HISTORY, -(long long)(sizeof(World) + MAX_ITEM_TYPES * sizeof(ItemType)));
+        free(past_world);
+        free(past_types);
+        past_world = NULL;
+        past_types = NULL;
+    }
+}
+
+// Function to make sure there is space for one more element in a growing array
+void* reserve_history(void *array, size_t count, size_t *capacity, size_t element_size) {
+    if (count == *capacity) {
+        size_t old_capacity = *capacity;
+        *capacity = *capacity == 0 ? 16 : *capacity * 2;
+        array = realloc(array, *capacity * element_size);
+        count_memory(MEMORY_HISTORY, (long long)(*capacity - old_capacity) * element_size);
+    }
+    return array;
+}
+
+// Function to add a delta at the current command time
+Delta* add_delta(int kind, int index) {
+    History *history = store->history;
+    history->deltas = reserve_history(history->deltas, history->delta_count, &history->delta_capacity, sizeof(Delta));
+    Delta *delta = &history->deltas[history->delta_count++];
+    delta->time = store->command_time;
+    delta->kind = kind;
+    delta->index = index;
+    delta->subject_index = 0;
+    delta->value = 0;
+    return delta;
+}
+
+// Function to keep a full copy of a version of the world as the world after a command
+void take_keyframe(World *version, long long time) {
+    History *history = store->history;
+    history->keyframes = reserve_history(history->keyframes, history->keyframe_count, &history->keyframe_capacity, sizeof(Keyframe));
+    Keyframe *keyframe = &history->keyframes[history->keyframe_count++];
+    keyframe->time = time;
+    keyframe->first_delta = history->delta_count;
+    keyframe->world = malloc(sizeof(World));
+    *keyframe->world = *version;
+    keyframe->types = aligned_alloc(32, (version->num_item_types + 1) * sizeof(ItemType));
+    count_memory(MEMORY_HISTORY, sizeof(World) + (version->num_item_types + 1) * sizeof(ItemType));
+    for (int i = 0; i < version->num_item_types; i++) {
+        keyframe->types[i] = *version->item_types[i];
+        keyframe->world->item_types[i] = &keyframe->types[i];
+    }
+}
+
+// Function to record the differences between the published version and the next one, called by the writer before publishing
+void record_history(World *previous, World *next) {
+    History *history = store->history;
+    pthread_mutex_lock(&history->lock);
+    // the first change of a command starts a new keyframe if the last one is old enough, previous is the world after the last command
+    if (store->command_time != history->last_delta_time && (history->keyframe_count == 0 || store->command_time - 1 - history->keyframes[history->keyframe_count - 1].time >= KEYFRAME_INTERVAL)) {
+        take_keyframe(previous, store->command_time - 1);
+    }
+
+    // subjects and locations are small, a changed one is kept whole
+    for (int i = 0; i < next->num_subjects; i++) {
+        if (i < previous->num_subjects && memcmp(&previous->subjects[i], &next->subjects[i], sizeof(Subject)) == 0) {
+            continue;
+        }
+        history->subject_records = reserve_history(history->subject_records, history->subject_record_count, &history->subject_record_capacity, sizeof(Subject));
+        history->subject_records[history->subject_record_count] = next->subjects[i];
+        add_delta(DELTA_SUBJECT, i)->value = history->subject_record_count++;
+    }
+    for (int i = 0; i < next->num_locations; i++) {
+        if (i < previous->num_locations && memcmp(&previous->locations[i], &next->locations[i], sizeof(Location)) == 0) {
+            continue;
+        }
+        history->location_records = reserve_history(history->location_records, history->location_record_count, &history->location_record_capacity, sizeof(Location));
+        history->location_records[history->location_record_count] = next->locations[i];
+        add_delta(DELTA_LOCATION, i)->value = history->location_record_count++;
+    }
+    // only the item types that are copied in this version can have changed quantities
+    for (int i = 0; i < next->num_item_types; i++) {
+        ItemType *type = next->item_types[i];
+        ItemType *old_type = i < previous->num_item_types ? previous->item_types[i] : NULL;
+        if (type == old_type) {
+            continue;
+        }
+        if (old_type == NULL) {
+            add_delta(DELTA_ITEM_TYPE, i)->value = type->name;
+        }
+        for (int j = 0; j < MAX_SUBJECTS; j++) {
+            if (type->quantity[j] != (old_type == NULL ? 0 : old_type->quantity[j])) {
+                Delta *delta = add_delta(DELTA_QUANTITY, i);
+                delta->subject_index = j;
+                delta->value = type->quantity[j];
+            }
+        }
+    }
+    history->last_delta_time = store->command_time;
+    pthread_mutex_unlock(&history->lock);
+}
+
+// Function to rebuild the world after a command from the nearest keyframe and the deltas after it
+// the cost depends on KEYFRAME_INTERVAL and the size of the world, not on the length of the history
+World* build_past_world(long long time) {
+    History *history = store->history;
+    if (past_world == NULL) {
+        past_world = malloc(sizeof(World));
+        past_types = aligned_alloc(32, MAX_ITEM_TYPES * sizeof(ItemType));
+        count_memory(MEMORY_HISTORY, sizeof(World) + MAX_ITEM_TYPES * sizeof(ItemType));
+    }
+    pthread_mutex_lock(&history->lock);
+    if (history->keyframe_count == 0) {
+        // nothing is written yet, the past is the same as now
+        pthread_mutex_unlock(&history->lock);
+        return NULL;
+    }
+
+    // find the last keyframe that is not after the time with binary search, the first keyframe is before every change
+    size_t low = 0;
+    size_t high = history->keyframe_count;
+    while (high - low > 1) {
+        size_t mid = (low + high) / 2;
+        if (history->keyframes[mid].time <= time) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    Keyframe *keyframe = &history->keyframes[low];
+    *past_world = *keyframe->world;
+    for (int i = 0; i < past_world->num_item_types; i++) {
+        past_types[i] = keyframe->types[i];
+        past_world->item_types[i] = &past_types[i];
+    }
+
+    // apply the deltas made until the time
+    for (size_t i = keyframe->first_delta; i < history->delta_count && history->deltas[i].time <= time; i++) {
+        Delta *delta = &history->deltas[i];
+        if (delta->kind == DELTA_SUBJECT) {
+            past_world->subjects[delta->index] = history->subject_records[delta->value];
+            if (delta->index >= past_world->num_subjects) {
+                past_world->num_subjects = delta->index + 1;
+            }
+        } else if (delta->kind == DELTA_LOCATION) {
+            past_world->locations[delta->index] = history->location_records[delta->value];
+            if (delta->index >= past_world->num_locations) {
+                past_world->num_locations = delta->index + 1;
+            }
+        } else if (delta->kind == DELTA_ITEM_TYPE) {
+            ItemType *type = &past_types[delta->index];
+            type->name = delta->value;
+            type->id = delta->index;
+            for (int j = 0; j < MAX_SUBJECTS; j++) {
+                type->quantity[j] = 0;
+                type->heap_pos[j] = -1;
+            }
+            past_world->item_types[delta->index] = type;
+            past_world->num_item_types = delta->index + 1;
+        } else {
+            past_types[delta->index].quantity[delta->subject_index] = delta->value;
+        }
+    }
+    pthread_mutex_unlock(&history->lock);
+
+    // the heaps are not kept in the deltas, rank the holders again
+    World *present = world;
+    world = past_world;
+    for (int i = 0; i < past_world->num_item_types; i++) {
+        rebuild_heap(past_world->item_types[i]);
+    }
+    world = present;
+    return past_world;
+}
+
+// Function to answer a question about the world after a command, the question is answered like a question about now
+int answer_question_at(char **tokens, int token_count, long long time) {
+    World *past = build_past_world(time);
+    if (past == NULL) {
+        return answer_question(tokens, token_count);
+    }
+    // answers about the past are not cached, the versions of the rebuilt subjects can be the same as now
+    World *present = world;
+    world = past;
+    reading_past = true;
+    int result = answer_question(tokens, token_count);
+    reading_past = false;
+    world = present;
+    return result;
+}
+
+
+//
+// 12. Recording and replaying command logs
+//
+
+// A recording starts with RECORD_MAGIC and has one record for every command: the time since the previous command started,
+// the time the command took (both in nanoseconds), the input line and the answer. numbers are written as varints
+// (7 bits in a byte, the high bit tells that more bytes follow) and texts as their varint length and bytes
+// a recording is replayed with the same --import files it is recorded with, so the world starts the same
+#define RECORD_MAGIC "RMLOG1\n"
+#define RECORD_MAGIC_LENGTH 7
+
+long long last_record_time = 0; // start time of the previous recorded command
+
+// Function to get the time of a monotonic clock in nanoseconds
+long long now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// Function to write a number as a varint
+void write_varint(FILE *file, unsigned long long value) {
+    while (value >= 0x80) {
+        fputc((value & 0x7f) | 0x80, file);
+        value >>= 7;
+    }
+    fputc(value, file);
+}
+
+// Function to read a varint, returns false at the end of the file or if the varint is broken
+bool read_varint(FILE *file, unsigned long long *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = fgetc(file);
+        if (byte == EOF) {
+            return false;
+        }
+        *value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function to open a recording and write its header, returns NULL if the file cannot be written
+FILE* start_recording(char *path) {
+    FILE *record = fopen(path, "wb");
+    if (record == NULL) {
+        return NULL;
+    }
+    fwrite(RECORD_MAGIC, 1, RECORD_MAGIC_LENGTH, record);
+    last_record_time = now_ns();
+    return record;
+}
+
+// Function to record a command with its timing, the answer is the output written since answer_start
+void record_command(FILE *record, char *line, long long start_time, long long latency, size_t answer_start) {
+    size_t line_length = strcspn(line, "\n");
+    size_t answer_length = output_size - answer_start;
+    write_varint(record, start_time - last_record_time);
+    write_varint(record, latency);
+    write_varint(record, line_length);
+    fwrite(line, 1, line_length, record);
+    write_varint(record, answer_length);
+    fwrite(output_buffer + answer_start, 1, answer_length, record);
+    last_record_time = start_time;
+}
+
+// Function to compare two numbers for qsort
+int compare_long_long(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Function to print a latency of a replay next to the recorded one
+void print_latency(const char *label, long long replayed, long long recorded) {
+    out_printf("%s: %.2f us (recorded %.2f us, %+.1f%%)\n", label, replayed / 1000.0, recorded / 1000.0, recorded == 0 ? 0.0 : 100.0 * (replayed - recorded) / recorded);
+}
+
+// Function to replay a recording at full speed, the answers are compared with the recorded ones and the timings are reported
+// returns -1 if the recording cannot be read, 1 if an answer is different and 0 otherwise
+int replay_log(char *path) {
+    FILE *record = fopen(path, "rb");
+    if (record == NULL) {
+        return -1;
+    }
+    char magic[RECORD_MAGIC_LENGTH];
+    if (fread(magic, 1, RECORD_MAGIC_LENGTH, record) != RECORD_MAGIC_LENGTH || memcmp(magic, RECORD_MAGIC, RECORD_MAGIC_LENGTH) != 0) {
+        fclose(record);
+        return -1;
+    }
+
+    char input[MAX_INPUT_LENGTH];
+    char *answer = NULL; // recorded answer
+    size_t answer_capacity = 0;
+    long long *recorded_latencies = NULL;
+    long long *replayed_latencies = NULL;
+    size_t latency_capacity = 0;
+    size_t command_count = 0;
+    size_t mismatch_count = 0;
+    bool broken = false;
+
+    unsigned long long gap;
+    while (read_varint(record, &gap)) {
+        // read the record
+        unsigned long long latency, line_length, answer_length;
+        if (!read_varint(record, &latency) || !read_varint(record, &line_length) || line_length >= MAX_INPUT_LENGTH
+            || fread(input, 1, line_length, record) != line_length || !read_varint(record, &answer_length)) {
+            broken = true;
+            break;
+        }
+        input[line_length] = '\0';
+        if (answer_length > answer_capacity) {
+            answer_capacity = answer_length;
+            answer = realloc(answer, answer_capacity);
+        }
+        if (fread(answer, 1, answer_length, record) != answer_length) {
+            broken = true;
+            break;
+        }
+        if (command_count == latency_capacity) {
+            latency_capacity = latency_capacity == 0 ? 1024 : latency_capacity * 2;
+            recorded_latencies = realloc(recorded_latencies, latency_capacity * sizeof(long long));
+            replayed_latencies = realloc(replayed_latencies, latency_capacity * sizeof(long long));
+        }
+
+        // run the command, its answer is compared and dropped
+        char line[MAX_INPUT_LENGTH];
+        strcpy(line, input);
+        size_t answer_start = output_size;
+        long long start_time = now_ns();
+        bool go_on = run_command(input);
+        replayed_latencies[command_count] = now_ns() - start_time;
+        recorded_latencies[command_count] = latency;
+        command_count++;
+        size_t replayed_length = output_size - answer_start;
+        if (replayed_length != answer_length || memcmp(output_buffer + answer_start, answer, answer_length) != 0) {
+            // report the first few differences, without the new lines at the end
+            if (mismatch_count++ < 10) {
+                fprintf(stderr, "%s: command %zu \"%s\": expected \"%.*s\" got \"%.*s\"\n", path, command_count, line,
+                        (int)answer_length - (answer_length > 0), answer, (int)replayed_length - (replayed_length > 0), output_buffer + answer_start);
+            }
+        }
+        output_size = answer_start;
+        if (!go_on) {
+            break;
+        }
+    }
+    fclose(record);
+    free(answer);
+    if (broken) {
+        fprintf(stderr, "%s: broken record after command %zu\n", path, command_count);
+    }
+
+    // report the throughput and the latencies, compared with the recording
+    long long recorded_total = 0;
+    long long replayed_total = 0;
+    for (size_t i = 0; i < command_count; i++) {
+        recorded_total += recorded_latencies[i];
+        replayed_total += replayed_latencies[i];
+    }
+    out_printf("replayed %zu commands, %zu different answers\n", command_count, mismatch_count);
+    if (command_count > 0) {
+        double recorded_rate = recorded_total == 0 ? 0.0 : command_count * 1e9 / recorded_total;
+        double replayed_rate = replayed_total == 0 ? 0.0 : command_count * 1e9 / replayed_total;
+        out_printf("throughput: %.0f commands/s (recorded %.0f commands/s, %+.1f%%)\n", replayed_rate, recorded_rate,
+                   recorded_rate == 0.0 ? 0.0 : 100.0 * (replayed_rate - recorded_rate) / recorded_rate);
+        qsort(recorded_latencies, command_count, sizeof(long long), compare_long_long);
+        qsort(replayed_latencies, command_count, sizeof(long long), compare_long_long);
+        print_latency("latency p50", replayed_latencies[command_count / 2], recorded_latencies[command_count / 2]);
+        print_latency("latency p99", replayed_latencies[command_count * 99 / 100], recorded_latencies[command_count * 99 / 100]);
+        print_latency("latency max", replayed_latencies[command_count - 1], recorded_latencies[command_count - 1]);
+    }
+    free(recorded_latencies);
+    free(replayed_latencies);
+    // and the memory used at the end of the replay
+    pin_world();
+    print_memory();
+    unpin_world();
+    return mismatch_count == 0 && !broken ? 0 : 1;
+}
+
+
+//
+// 13. Test runner
+//
+
+// Test cases are pairs of an input file and the output the program should write for it, either "NAME.in" and "NAME.out"
+// or "input/NAME" and "output/NAME" in the test directory. every case runs in this process with a fresh store, on a pool of threads
+// a case can also have a file to import before its input, "NAME.import" or "import/NAME"
+// the memory counters are for the whole process, so "memory ?" in a case only answers with the lines about its world
+
+// Struct for a test case and its result
+typedef struct {
+    char *name;
+    char *input;
+    size_t input_length;
+    char *expected;
+    size_t expected_length;
+    char *import_path; // file to import before the input, NULL if there is none
+    bool passed;
+    long long command_count;
+    long long time; // nanoseconds the case took
+    char *difference; // the first different line, if the case failed
+} TestCase;
+
+TestCase *test_cases = NULL;
+int test_case_count = 0;
+int test_case_capacity = 0;
+_Atomic int next_test_case = 0; // index of the next case a thread takes
+
+// Function to read a whole file into memory, returns NULL if it cannot be read
+char* read_whole_file(char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    size_t capacity = 4096;
+    char *text = malloc(capacity);
+    *length = 0;
+    size_t read;
+    while ((read = fread(text + *length, 1, capacity - *length, file)) > 0) {
+        *length += read;
+        if (*length == capacity) {
+            capacity *= 2;
+            text = realloc(text, capacity);
+        }
+    }
+    fclose(file);
+    return text;
+}
+
+// Function to add a test case if both of its files can be read, the import file is used only if it exists
+void add_test_case(char *name, char *input_path, char *output_path, char *import_path) {
+    TestCase test_case = {0};
+    test_case.input = read_whole_file(input_path, &test_case.input_length);
+    test_case.expected = read_whole_file(output_path, &test_case.expected_length);
+    if (test_case.input == NULL || test_case.expected == NULL) {
+        free(test_case.input);
+        free(test_case.expected);
+        return;
+    }
+    test_case.name = strdup(name);
+    if (access(import_path, R_OK) == 0) {
+        test_case.import_path = strdup(import_path);
+    }
+    if (test_case_count == test_case_capacity) {
+        test_case_capacity = test_case_capacity == 0 ? 64 : test_case_capacity * 2;
+        test_cases = realloc(test_cases, test_case_capacity * sizeof(TestCase));
+    }
+    test_cases[test_case_count++] = test_case;
+}
+
+// Function to compare two test cases by name for qsort
+int compare_test_cases(const void *a, const void *b) {
+    return strcmp(((const TestCase *)a)->name, ((const TestCase *)b)->name);
+}
+
+// Function to find the test cases in a directory, returns the number of cases
+int load_test_cases(char *directory) {
+    char path[4096];
+    char other_path[4096];
+    char import_path[4096];
+    DIR *dir = opendir(directory);
+    if (dir == NULL) {
+        return 0;
+    }
+    // NAME.in and NAME.out
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length > 3 && strcmp(entry->d_name + length - 3, ".in") == 0) {
+            snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+            snprintf(other_path, sizeof(other_path), "%s/%.*s.out", directory, (int)(length - 3), entry->d_name);
+            snprintf(import_path, sizeof(import_path), "%s/%.*s.import", directory, (int)(length - 3), entry->d_name);
+            entry->d_name[length - 3] = '\0'; // the case is named without .in
+            add_test_case(entry->d_name, path, other_path, import_path);
+        }
+    }
+    closedir(dir);
+
+    // input/NAME and output/NAME
+    snprintf(path, sizeof(path), "%s/input", directory);
+    dir = opendir(path);
+    if (dir != NULL) {
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.') {
+                snprintf(path, sizeof(path), "%s/input/%s", directory, entry->d_name);
+                snprintf(other_path, sizeof(other_path), "%s/output/%s", directory, entry->d_name);
+                snprintf(import_path, sizeof(import_path), "%s/import/%s", directory, entry->d_name);
+                add_test_case(entry->d_name, path, other_path, import_path);
+            }
+        }
+        closedir(dir);
+    }
+    qsort(test_cases, test_case_count, sizeof(TestCase), compare_test_cases);
+    return test_case_count;
+}
+
+// Function to take the next line of a text like read_input_line does, returns false at the end of the text
+bool next_test_line(TestCase *test_case, size_t *position, char *line) {
+    if (*position == test_case->input_length) {
+        return false;
+    }
+    size_t available = test_case->input_length - *position;
+    if (available > MAX_INPUT_LENGTH - 1) {
+        available = MAX_INPUT_LENGTH - 1;
+    }
+    char *start = test_case->input + *position;
+    char *new_line = memchr(start, '\n', available);
+    size_t length = new_line == NULL ? available : (size_t)(new_line - start) + 1;
+    memcpy(line, start, length);
+    line[length] = '\0';
+    *position += length;
+    return true;
+}
+
+// Function to find the first line that is different in two outputs, returns NULL if they are the same (trailing new lines are ignored)
+char* find_difference(char *output, size_t output_length, char *expected, size_t expected_length) {
+    while (output_length > 0 && output[output_length - 1] == '\n') {
+        output_length--;
+    }
+    while (expected_length > 0 && expected[expected_length - 1] == '\n') {
+        expected_length--;
+    }
+    if (output_length == expected_length && memcmp(output, expected, output_length) == 0) {
+        return NULL;
+    }
+    size_t line_start = 0;
+    int line_number = 1;
+    for (size_t i = 0; i < output_length && i < expected_length && output[i] == expected[i]; i++) {
+        if (output[i] == '\n') {
+            line_start = i + 1;
+            line_number++;
+        }
+    }
+    int output_line = strcspn(output + line_start, "\n");
+    int expected_line = strcspn(expected + line_start, "\n");
+    if (line_start + output_line > output_length) {
+        output_line = output_length - line_start;
+    }
+    if (line_start + expected_line > expected_length) {
+        expected_line = expected_length - line_start;
+    }
+    char *difference = malloc(output_line + expected_line + 64);
+    sprintf(difference, "line %d: expected \"%.*s\" got \"%.*s\"", line_number, expected_line, expected + line_start, output_line, output + line_start);
+    return difference;
+}
+
+// Struct for the reader threads that share the store of a case while it is run
+typedef struct TestReaders TestReaders;
+
+// Struct for a thread that asks the questions of a case on the store of the case
+typedef struct {
+    TestReaders *readers;
+    TestCase *test_case;
+    Store *shared_store;
+    char *answers; // answers after the case is written, compared with the answers of the thread that ran the case
+    size_t answers_length;
+    char *difference; // the first wrong answer while the case is written, NULL if there is none
+} ReaderCheck;
+
+struct TestReaders {
+    _Atomic bool writing; // the thread that runs the case has not run all of its commands yet
+    ReaderCheck *checks;
+    pthread_t *threads;
+    int started;
+};
+
+// readers that share the store of every case while it is run, 0 if the stores are not shared
+int test_reader_count = 0;
+
+// Function to check if a line is a question, the last character before the new line is "?"
+bool is_question_line(char *line) {
+    size_t length = strcspn(line, "\n");
+    while (length > 0 && isspace((unsigned char)line[length - 1])) {
+        length--;
+    }
+    return length > 0 && line[length - 1] == '?';
+}
+
+// Function to ask every question of a case on the store of the current thread, the answers are collected in the output buffer
+void ask_test_questions(TestCase *test_case) {
+    char line[MAX_INPUT_LENGTH];
+    size_t position = 0;
+    while (next_test_line(test_case, &position, line)) {
+        if (is_question_line(line)) {
+            execute_line(line);
+        }
+    }
+}
+
+// Function to get the length of a question before its "?", returns -1 if it is not a question about now ending with " ?"
+// "QUESTION at time N ?" asks the same question about the world after the N-th command, for questions of 3 or more words
+int present_question_length(char *line) {
+    if (!is_question_line(line)) {
+        return -1;
+    }
+    int length = strrchr(line, '?') - line;
+    if (length == 0 || line[length - 1] != ' ') {
+        return -1;
+    }
+    char copy[MAX_INPUT_LENGTH];
+    strcpy(copy, line);
+    copy[strcspn(copy, "\n")] = '\0';
+    int token_count = 0;
+    char **tokens = parse_sentence(copy, &token_count);
+    bool past = is_past_question(tokens, token_count);
+    free_tokens(tokens, token_count);
+    return past || token_count < 3 ? -1 : length;
+}
+
+// Function to ask the questions of a case about now in turns, as long as the thread that runs the case writes new versions
+// a question reads a version published from the end of the last command before it to the end of the command that runs when it ends,
+// so its answer should be the answer about the world after one of these commands. returns the first wrong answer, NULL if there is none
+char* check_answers_while_writing(TestCase *test_case, _Atomic bool *writing) {
+    char line[MAX_INPUT_LENGTH];
+    char past_line[MAX_INPUT_LENGTH + 32];
+    size_t position = 0;
+    bool asked = false; // a question is asked since the first line
+    while (atomic_load(writing)) {
+        if (!next_test_line(test_case, &position, line)) {
+            if (!asked) {
+                sched_yield(); // the case has no question to ask, wait until it is written
+            }
+            position = 0;
+            continue;
+        }
+        int length = present_question_length(line);
+        if (length == -1) {
+            continue;
+        }
+        asked = true;
+        char question[MAX_INPUT_LENGTH];
+        snprintf(question, sizeof(question), "%.*s", length, line);
+
+        output_size = 0;
+        long long first_time = atomic_load(&store->command_time) - 1;
+        execute_line(line);
+        long long last_time = atomic_load(&store->command_time);
+        size_t answer_length = output_size;
+        bool found = false;
+        for (long long time = first_time < 0 ? 0 : first_time; time <= last_time && !found; time++) {
+            snprintf(past_line, sizeof(past_line), "%sat time %lld ?", question, time);
+            execute_line(past_line);
+            found = output_size - answer_length == answer_length && memcmp(output_buffer, output_buffer + answer_length, answer_length) == 0;
+            output_size = answer_length;
+        }
+        if (!found) {
+            char *difference = malloc(strlen(question) + answer_length + 128);
+            sprintf(difference, "\"%s?\" got \"%.*s\", the answer after none of the commands %lld to %lld", question, (int)strcspn(output_buffer, "\n"),
+                    output_buffer, first_time < 0 ? 0 : first_time, last_time);
+            output_size = 0;
+            return difference;
+        }
+        sched_yield(); // let the thread that runs the case go on, one question is asked in a turn
+    }
+    output_size = 0;
+    return NULL;
+}
+
+// Function for a reader thread, it binds the shared store and asks the questions while the case is written and once after that
+void* test_reader(void *argument) {
+    ReaderCheck *check = argument;
+    bind_store(check->shared_store);
+    check->difference = check_answers_while_writing(check->test_case, &check->readers->writing);
+    output_size = 0;
+    ask_test_questions(check->test_case);
+    check->answers = malloc(output_size + 1);
+    memcpy(check->answers, output_buffer, output_size);
+    check->answers_length = output_size;
+    release_reader();
+    free_answer_cache();
+    free_past_world();
+    free_output();
+    return NULL;
+}
+
+// Function to start test_reader_count threads that share the store of the current thread, before the case is run on it
+TestReaders* start_test_readers(TestCase *test_case) {
+    TestReaders *readers = calloc(1, sizeof(TestReaders));
+    atomic_store(&readers->writing, true);
+    readers->checks = calloc(test_reader_count, sizeof(ReaderCheck));
+    readers->threads = malloc(test_reader_count * sizeof(pthread_t));
+    for (int i = 0; i < test_reader_count; i++) {
+        readers->checks[i] = (ReaderCheck){readers, test_case, store, NULL, 0, NULL};
+        if (pthread_create(&readers->threads[i], NULL, test_reader, &readers->checks[i]) != 0) {
+            break;
+        }
+        readers->started++;
+    }
+    return readers;
+}
+
+// Function to wait for the readers of a case after it is run, and check them
+// every answer while the case is written must be the answer after some command, every answer after it must be the answer
+// of the thread that ran the case, and every reader slot must be free after the readers end. returns the first problem, NULL if there is none
+char* finish_test_readers(TestReaders *readers, TestCase *test_case) {
+    atomic_store(&readers->writing, false);
+    output_size = 0;
+    ask_test_questions(test_case);
+    release_reader(); // the thread that ran the case stops reading too
+    for (int i = 0; i < readers->started; i++) {
+        pthread_join(readers->threads[i], NULL);
+    }
+
+    char *difference = NULL;
+    if (readers->started < test_reader_count) {
+        difference = malloc(64);
+        sprintf(difference, "readers: started %d of %d threads", readers->started, test_reader_count);
+    }
+    for (int i = 0; i < readers->started; i++) {
+        ReaderCheck *check = &readers->checks[i];
+        char *answers_difference = find_difference(check->answers, check->answers_length, output_buffer, output_size);
+        char *reader_difference = check->difference != NULL ? check->difference : answers_difference;
+        if (reader_difference != NULL && difference == NULL) {
+            difference = malloc(strlen(reader_difference) + 64);
+            sprintf(difference, "reader %d: %s", i + 1, reader_difference);
+        }
+        free(check->difference);
+        free(answers_difference);
+        free(check->answers);
+    }
+    for (int i = 0; i < MAX_READERS && difference == NULL; i++) {
+        if (atomic_load(&store->reader_slot_used[i])) {
+            difference = malloc(64);
+            sprintf(difference, "readers: reader slot %d was not given back", i);
+        }
+    }
+    output_size = 0;
+    free(readers->checks);
+    free(readers->threads);
+    free(readers);
+    return difference;
+}
+
+// Function to run a test case like the command loop runs the standard input, with a fresh store
+// with test_reader_count readers, threads that share the store ask the questions of the case while it is run
+void run_test_case(TestCase *test_case) {
+    char line[MAX_INPUT_LENGTH];
+    size_t position = 0;
+    long long start_time = now_ns();
+    bind_store(create_store());
+    if (test_case->import_path != NULL) {
+        import_file(test_case->import_path);
+    }
+    TestReaders *readers = test_reader_count > 0 ? start_test_readers(test_case) : NULL;
+    output_size = 0;
+    while (true) {
+        out_string(">> ");
+        if (!next_test_line(test_case, &position, line)) {
+            break;
+        }
+        test_case->command_count++;
+        if (!run_command(line)) {
+            break;
+        }
+        if (readers != NULL) {
+            sched_yield(); // let the readers read the version of this command
+        }
+    }
+    test_case->time = now_ns() - start_time;
+    test_case->difference = find_difference(output_buffer, output_size, test_case->expected, test_case->expected_length);
+    if (readers != NULL) {
+        char *difference = finish_test_readers(readers, test_case);
+        if (test_case->difference == NULL) {
+            test_case->difference = difference;
+        } else {
+            free(difference);
+        }
+    }
+    free_store(store);
+    test_case->passed = test_case->difference == NULL;
+    output_size = 0;
+}
+
+// Function for the threads of the pool, every thread takes the next case until there is none
+void* test_worker(void *argument) {
+    (void)argument;
+    int index;
+    while ((index = atomic_fetch_add(&next_test_case, 1)) < test_case_count) {
+        run_test_case(&test_cases[index]);
+    }
+    free_answer_cache();
+    free_past_world();
+    free_output();
+    return NULL;
+}
+
+// Function to run the test cases of a directory on thread_count threads and report every case and the throughput
+// with reader_count readers, every case is also checked by that many threads that read its store at the same time
+// returns -1 if there are no cases, 1 if a case failed and 0 otherwise
+int run_tests(char *directory, int thread_count, int reader_count) {
+    if (load_test_cases(directory) == 0) {
+        return -1;
+    }
+    test_reader_count = reader_count;
+    print_memory_counters = false; // "memory ?" only answers with the item slots and locations of the case
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+    if (thread_count > test_case_count) {
+        thread_count = test_case_count;
+    }
+
+    long long start_time = now_ns();
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    for (int i = 0; i < thread_count; i++) {
+        pthread_create(&threads[i], NULL, test_worker, NULL);
+    }
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    long long wall_time = now_ns() - start_time;
+
+    int passed = 0;
+    long long command_count = 0;
+    for (int i = 0; i < test_case_count; i++) {
+        TestCase *test_case = &test_cases[i];
+        out_printf("%s %s %.3f ms (%lld commands)\n", test_case->passed ? "PASS" : "FAIL", test_case->name, test_case->time / 1e6, test_case->command_count);
+        if (!test_case->passed) {
+            out_printf("    %s\n", test_case->difference);
+        }
+        passed += test_case->passed;
+        command_count += test_case->command_count;
+    }
+    out_printf("passed %d of %d cases in %.3f ms on %d threads, %.0f commands/s\n", passed, test_case_count, wall_time / 1e6, thread_count,
+               wall_time == 0 ? 0.0 : command_count * 1e9 / wall_time);
+    return passed == test_case_count ? 0 : 1;
+}
@@ -1,13 +1,19 @@
 QT += widgets
 
 HEADERS += \
-    flagbutton.h \
-    mainwindow.h
+    board.h \
+    boardview.h \
+    game.h \
+    mainwindow.h \
+    solver.h
 
 SOURCES += \
-    flagbutton.cpp \
+    board.cpp \
+    boardview.cpp \
+    game.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    solver.cpp
 
 RESOURCES += \
     resources.qrc
@@ -0,0 +1,19 @@
+QT += widgets
+
+INCLUDEPATH += ..
+
+HEADERS += \
+    ../board.h \
+    ../boardview.h \
+    ../game.h \
+    ../solver.h
+
+SOURCES += \
+    ../board.cpp \
+    ../boardview.cpp \
+    ../game.cpp \
+    ../solver.cpp \
+    main.cpp
+
+RESOURCES += \
+    ../resources.qrc
@@ -0,0 +1,170 @@
+// Benchmark for the board, run it with "-platform offscreen" to run it without a display
+#include "boardview.h"
+#include "game.h"
+#include <QApplication>
+#include <QScrollArea>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <algorithm>
+#include <vector>
+
+// Print the minimum, median, 99th percentile and maximum of a list of nanosecond timings
+static void printTimings(QTextStream &out, const char *name, std::vector<qint64> &timings)
+{
+    std::sort(timings.begin(), timings.end());
+    auto micro = [](qint64 ns) { return QString::number(ns / 1000.0, 'f', 1); };
+    out << name << ": " << int(timings.size()) << " runs, min " << micro(timings.front())
+        << " us, median " << micro(timings[timings.size() / 2])
+        << " us, p99 " << micro(timings[timings.size() * 99 / 100])
+        << " us, max " << micro(timings.back()) << " us\n";
+}
+
+// Click random cells of the largest board and measure the time from the mouse press to the repainted cells
+// the clicks go through the game like in MainWindow::revealCell, only hidden cells without mines in the visible part are clicked
+static void benchmarkClicks(QTextStream &out, int rows, int cols, int mines, int clicks)
+{
+    QScrollArea scrollArea;
+    BoardView *view = new BoardView;
+    scrollArea.setWidget(view);
+    scrollArea.resize(900, 600);
+
+    QElapsedTimer timer;
+    timer.start();
+    view->setBoardSize(rows, cols);
+    scrollArea.show();
+    QApplication::processEvents();
+    out << rows << "x" << cols << " board shown in " << timer.elapsed() << " ms\n";
+
+    // a click reveals the cell and shows the numbers of all opened cells with one repaint, like MainWindow::revealCell
+    Game game;
+    QObject::connect(view, &BoardView::cellClicked, view, [&game, view](int row, int col) {
+        std::vector<int> opened = game.reveal(row, col);
+        const Board &board = game.getBoard();
+        for (int cell : opened) {
+            view->queueSprite(board.rowOf(cell), board.colOf(cell), board.valueAt(cell));
+        }
+        view->flushSprites();
+    });
+
+    auto click = [view](int row, int col) {
+        QPointF pos(col * BoardView::cellSize + BoardView::cellSize / 2, row * BoardView::cellSize + BoardView::cellSize / 2);
+        QMouseEvent press(QEvent::MouseButtonPress, pos, pos, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+        QMouseEvent release(QEvent::MouseButtonRelease, pos, pos, Qt::LeftButton, Qt::NoButton, Qt::NoModifier);
+        QApplication::sendEvent(view, &press);
+        QApplication::sendEvent(view, &release);
+        QApplication::processEvents();  // paint the revealed cells
+    };
+
+    // click inside the visible part, otherwise nothing has to be repainted
+    int visibleRows = qMin(rows, 600 / BoardView::cellSize);
+    int visibleCols = qMin(cols, 900 / BoardView::cellSize);
+    std::vector<std::pair<int, int>> hidden;  // Visible cells that can be clicked without losing
+    std::vector<qint64> timings;
+    timings.reserve(clicks);
+    int games = 0;
+    auto startGame = [&]() {
+        // the first click places the mines, it is not measured
+        game.newGame(rows, cols, mines, games++);
+        view->setBoardSize(rows, cols);
+        click(0, 0);
+    };
+    startGame();
+    while (int(timings.size()) < clicks) {
+        hidden.clear();
+        for (int row = 0; row < visibleRows; ++row) {
+            for (int col = 0; col < visibleCols; ++col) {
+                if (!game.isRevealed(row, col) && !game.getBoard().isMine(row, col)) {
+                    hidden.push_back({row, col});
+                }
+            }
+        }
+        if (hidden.empty()) {
+            startGame();  // The visible part is revealed
+            continue;
+        }
+
+        std::pair<int, int> cell = hidden[QRandomGenerator::global()->bounded(int(hidden.size()))];
+        timer.start();
+        click(cell.first, cell.second);
+        timings.push_back(timer.nsecsElapsed());
+    }
+    printTimings(out, "click to reveal", timings);
+}
+
+// Generate a large board, as the batch generators do, only the engine is used
+static void benchmarkGeneration(QTextStream &out, int rows, int cols, int mines)
+{
+    BoardRandom random(1);  // The same board on every run
+    QElapsedTimer timer;
+    timer.start();
+    Board board(rows, cols);
+    board.placeMines(mines, random);  // Place mines and calculate numbers
+    out << rows << "x" << cols << " board with " << mines << " mines generated in " << timer.elapsed() << " ms\n";
+}
+
+// Reveal the largest opening of a board with few mines, only the engine is used
+static void benchmarkOpening(QTextStream &out, int rows, int cols, int mines)
+{
+    Game game;
+    game.newGame(rows, cols, mines, 1);
+    // the first click places the mines away from the clicked cell, with few mines its opening is almost the whole board
+    QElapsedTimer timer;
+    timer.start();
+    size_t opened = game.reveal(rows / 2, cols / 2).size();
+    out << "first click opened " << qint64(opened) << " cells in " << QString::number(timer.nsecsElapsed() / 1e6, 'f', 2) << " ms\n";
+}
+
+// Ask for hints on a large board and reveal them, only the engine is used
+static void benchmarkHints(QTextStream &out, int rows, int cols, int mines, int hints)
+{
+    Game game;
+    game.newGame(rows, cols, mines, 1);
+    game.reveal(rows / 2, cols / 2);
+    std::vector<qint64> timings;
+    timings.reserve(hints);
+    QElapsedTimer timer;
+    for (int i = 0; i < hints && game.getState() == Game::Playing; ++i) {
+        timer.start();
+        std::pair<int, int> hint = game.findHint();
+        timings.push_back(timer.nsecsElapsed());
+        if (hint.first == -1) {
+            break;  // No safe cell left to reveal
+        }
+        game.reveal(hint.first, hint.second);
+    }
+    printTimings(out, "hint", timings);
+}
+
+// Play games with random clicks until they end, only the engine is used
+// the boards and the clicks come from fixed seeds, so every run plays the same games
+static void benchmarkGames(QTextStream &out, int rows, int cols, int mines, int games)
+{
+    Game game(rows, cols, mines);
+    BoardRandom clicks(0);
+    int won = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < games; ++i) {
+        game.newGame(rows, cols, mines, i);
+        while (game.getState() == Game::Playing) {
+            game.reveal(clicks.bounded(rows), clicks.bounded(cols));
+        }
+        won += game.getState() == Game::Won;
+    }
+    double seconds = timer.nsecsElapsed() / 1e9;
+    out << games << " games of " << rows << "x" << cols << " with " << mines << " mines played in " << QString::number(seconds, 'f', 2)
+        << " s, " << QString::number(games / seconds, 'f', 0) << " games/s, " << won << " won\n";
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+    benchmarkClicks(out, 1000, 1000, 200000, 2000);
+    benchmarkGeneration(out, 10000, 10000, 15000000);
+    benchmarkOpening(out, 1000, 1000, 100);
+    benchmarkHints(out, 1000, 1000, 150000, 1000);
+    benchmarkGames(out, 9, 9, 10, 100000);
+    return 0;
+}
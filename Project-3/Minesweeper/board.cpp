@@ -0,0 +1,247 @@
+#include "board.h"
+#include <array>
+#include <cstring>
+
+// Constructor for BoardRandom, starts the numbers of a seed
+BoardRandom::BoardRandom(std::uint64_t seed)
+    : seed(seed)
+    , counter(0)
+{
+}
+
+// Get the next 64 random bits, the counter is mixed with the seed by the SplitMix64 finalizer
+std::uint64_t BoardRandom::next()
+{
+    std::uint64_t z = seed + ++counter * 0x9e3779b97f4a7c15;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// Get a random number from 0 to bound - 1 without bias, by multiplying 32 random bits with the bound
+// and rejecting the few products that would make some numbers more likely
+int BoardRandom::bounded(int bound)
+{
+    std::uint32_t range = bound;
+    std::uint64_t product = (next() >> 32) * range;
+    if (std::uint32_t(product) < range) {
+        std::uint32_t threshold = -range % range;
+        while (std::uint32_t(product) < threshold) {
+            product = (next() >> 32) * range;
+        }
+    }
+    return product >> 32;
+}
+
+// Constructor for Board, creates a board without mines
+Board::Board(int rows, int cols)
+    : rows(rows)
+    , cols(cols)
+    , stride(cols + 2)
+    , mines(0)
+    , neighbourOffsets{-stride - 1, -stride, -stride + 1, -1, 1, stride - 1, stride, stride + 1}
+    , cells((rows + 2) * (cols + 2), 0)
+    , words((cols + 63) / 64)
+    , mineBits((rows + 2) * words, 0)
+{
+}
+
+// Number of rows
+int Board::rowCount() const
+{
+    return rows;
+}
+
+// Number of columns
+int Board::colCount() const
+{
+    return cols;
+}
+
+// Number of mines
+int Board::mineCount() const
+{
+    return mines;
+}
+
+// Number of cells in the array, including the border, indices of cells are less than this
+int Board::cellCount() const
+{
+    return cells.size();
+}
+
+// Check if a cell is on the board
+bool Board::contains(int row, int col) const
+{
+    return row >= 0 && row < rows && col >= 0 && col < cols;
+}
+
+// Get the index of a cell in the array
+int Board::index(int row, int col) const
+{
+    return (row + 1) * stride + col + 1;
+}
+
+// Get the row of an index
+int Board::rowOf(int index) const
+{
+    return index / stride - 1;
+}
+
+// Get the column of an index
+int Board::colOf(int index) const
+{
+    return index % stride - 1;
+}
+
+// Get the offsets of the 8 neighbours of a cell, the neighbours of a cell on the board are on the board or on the border
+const int *Board::neighbours() const
+{
+    return neighbourOffsets;
+}
+
+// Check if a cell is a mine
+bool Board::isMine(int row, int col) const
+{
+    return cells[index(row, col)] == Mine;
+}
+
+// Get the value of a cell, -1 for mines and the number of neighbouring mines for other cells
+int Board::value(int row, int col) const
+{
+    return cells[index(row, col)];
+}
+
+// Check if the cell at an index is a mine
+bool Board::isMineAt(int index) const
+{
+    return cells[index] == Mine;
+}
+
+// Get the value of the cell at an index
+int Board::valueAt(int index) const
+{
+    return cells[index];
+}
+
+// Place mines randomly on the board and calculate the numbers
+// no mine is placed on the safe cell, or on its neighbours if there are enough other cells for the mines
+// Floyd's sampling picks every mine with one random number, so this takes the same time however dense the mines are
+void Board::placeMines(int mines, BoardRandom &random, int safeRow, int safeCol)
+{
+    this->mines = mines;
+    int excluded[9];  // Numbers of the cells that stay free of mines, in increasing order
+    int excludedCount = 0;
+    if (contains(safeRow, safeCol)) {
+        for (int row = safeRow - 1; row <= safeRow + 1; ++row) {
+            for (int col = safeCol - 1; col <= safeCol + 1; ++col) {
+                if (contains(row, col)) {
+                    excluded[excludedCount++] = row * cols + col;
+                }
+            }
+        }
+        if (mines > rows * cols - excludedCount) {
+            excluded[0] = safeRow * cols + safeCol;  // Too many mines, only keep the safe cell itself free
+            excludedCount = mines < rows * cols ? 1 : 0;
+        }
+    }
+
+    // Number of the k-th cell that is not excluded
+    auto cellNumber = [&](int k) {
+        for (int i = 0; i < excludedCount; ++i) {
+            k += excluded[i] <= k;
+        }
+        return k;
+    };
+
+    int candidates = rows * cols - excludedCount;
+    for (int j = candidates - mines; j < candidates; ++j) {
+        int cell = cellNumber(random.bounded(j + 1));
+        if (hasMine(cell / cols, cell % cols)) {
+            cell = cellNumber(j);  // Already a mine, take the j-th cell which cannot be one yet
+        }
+        setMine(cell / cols, cell % cols);  // Mark as mine
+    }
+    calculateNumbers();
+}
+
+// Set the bit of a mine in the bitboard
+void Board::setMine(int row, int col)
+{
+    mineBits[(row + 1) * words + col / 64] |= std::uint64_t(1) << (col % 64);
+}
+
+// Check the bit of a cell in the bitboard
+bool Board::hasMine(int row, int col) const
+{
+    return mineBits[(row + 1) * words + col / 64] >> (col % 64) & 1;
+}
+
+// Table that spreads the 8 bits of a byte to the 8 bytes of a word, byte i of the word in memory is bit i of the byte
+static const std::array<std::uint64_t, 256> spread = [] {
+    std::array<std::uint64_t, 256> table;
+    for (int bits = 0; bits < 256; ++bits) {
+        unsigned char bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = bits >> i & 1;
+        }
+        std::memcpy(&table[bits], bytes, 8);
+    }
+    return table;
+}();
+
+// Calculate the number of mines surrounding each cell
+// the counts of 64 cells are added at once from the bitboard: every bit of the words below is a cell and a count is kept
+// in 4 words, one for each bit of it. the counts are then written to the cells 8 at a time
+void Board::calculateNumbers()
+{
+    std::vector<std::uint64_t> sumLow(words * 3), sumHigh(words * 3);  // Sum of each cell and its left and right neighbours in 3 rows
+
+    // Sum of a mine and its left and right neighbours for each cell of a row of the bitboard, stored in slot row % 3
+    auto sumRow = [&](int row) {
+        const std::uint64_t *bits = &mineBits[row * words];
+        std::uint64_t *low = &sumLow[row % 3 * words];
+        std::uint64_t *high = &sumHigh[row % 3 * words];
+        for (int w = 0; w < words; ++w) {
+            std::uint64_t left = bits[w] << 1 | (w > 0 ? bits[w - 1] >> 63 : 0);  // Mine of the left neighbour of each cell
+            std::uint64_t right = bits[w] >> 1 | (w + 1 < words ? bits[w + 1] << 63 : 0);  // Mine of the right neighbour of each cell
+            low[w] = left ^ bits[w] ^ right;
+            high[w] = (left & bits[w]) | (left & right) | (bits[w] & right);
+        }
+    };
+    sumRow(0);
+    sumRow(1);
+
+    for (int row = 0; row < rows; ++row) {
+        sumRow(row + 2);
+        const std::uint64_t *bits = &mineBits[(row + 1) * words];
+        const std::uint64_t *aboveLow = &sumLow[row % 3 * words], *aboveHigh = &sumHigh[row % 3 * words];
+        const std::uint64_t *belowLow = &sumLow[(row + 2) % 3 * words], *belowHigh = &sumHigh[(row + 2) % 3 * words];
+        int cell = index(row, 0);
+        for (int w = 0; w < words; ++w) {
+            // Left and right neighbours in the same row, the cell itself is not counted
+            std::uint64_t left = bits[w] << 1 | (w > 0 ? bits[w - 1] >> 63 : 0);
+            std::uint64_t right = bits[w] >> 1 | (w + 1 < words ? bits[w + 1] << 63 : 0);
+            std::uint64_t sideLow = left ^ right, sideHigh = left & right;
+
+            // Add the three 2 bit sums into a 4 bit count
+            std::uint64_t carry = (aboveLow[w] & belowLow[w]) | (aboveLow[w] & sideLow) | (belowLow[w] & sideLow);
+            std::uint64_t bit0 = aboveLow[w] ^ belowLow[w] ^ sideLow;
+            std::uint64_t twos = aboveHigh[w] ^ belowHigh[w] ^ sideHigh;
+            std::uint64_t fours = (aboveHigh[w] & belowHigh[w]) | (aboveHigh[w] & sideHigh) | (belowHigh[w] & sideHigh);
+            std::uint64_t bit1 = twos ^ carry;
+            std::uint64_t bit2 = fours ^ (twos & carry);
+            std::uint64_t bit3 = fours & twos & carry;
+
+            // Write the counts of the cells in this word, 8 cells at a time, mines become -1
+            int count = cols - w * 64 < 64 ? cols - w * 64 : 64;
+            for (int i = 0; i < count; i += 8, cell += 8) {
+                std::uint64_t values = spread[bit0 >> i & 0xff] | spread[bit1 >> i & 0xff] << 1
+                                       | spread[bit2 >> i & 0xff] << 2 | spread[bit3 >> i & 0xff] << 3;
+                std::uint64_t mineBytes = spread[bits[w] >> i & 0xff] * 0xff;
+                values = (values & ~mineBytes) | mineBytes;
+                std::memcpy(&cells[cell], &values, count - i < 8 ? count - i : 8);
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <vector>
+#include <cstdint>
+
+// Random numbers for generating boards, the n-th number only depends on the seed and n
+// the numbers are computed by mixing a counter with the seed without any library distribution, so a seed gives the same
+// board with every compiler and on every machine
+class BoardRandom {
+public:
+    explicit BoardRandom(std::uint64_t seed = 0);
+    std::uint64_t next();
+    int bounded(int bound);
+
+private:
+    std::uint64_t seed;
+    std::uint64_t counter;
+};
+
+// Mines and numbers of a board, without any game or widget state
+// the cells are kept row by row in one array with a border of one cell around the board, so the 8 neighbours of every cell
+// are at fixed offsets from it and loops over neighbours need no bounds checks. the border cells are never mines
+// the mines are also kept as a bitboard, one bit per cell with each row packed into 64 bit words, the numbers are counted from it
+class Board {
+public:
+    static const signed char Mine = -1;
+
+    Board(int rows = 0, int cols = 0);
+    int rowCount() const;
+    int colCount() const;
+    int mineCount() const;
+    int cellCount() const;
+    bool contains(int row, int col) const;
+    int index(int row, int col) const;
+    int rowOf(int index) const;
+    int colOf(int index) const;
+    const int *neighbours() const;
+    bool isMine(int row, int col) const;
+    int value(int row, int col) const;
+    bool isMineAt(int index) const;
+    int valueAt(int index) const;
+    void placeMines(int mines, BoardRandom &random, int safeRow = -1, int safeCol = -1);
+
+private:
+    void setMine(int row, int col);
+    bool hasMine(int row, int col) const;
+    void calculateNumbers();
+
+    int rows;
+    int cols;
+    int stride; // cells in a row of the array, including the border
+    int mines;
+    int neighbourOffsets[8]; // offsets of the 8 neighbours of a cell in the array
+    std::vector<signed char> cells; // -1 for mines, 0-8 for numbers, 0 for the border
+    int words; // 64 bit words in a row of the bitboard
+    std::vector<std::uint64_t> mineBits; // bitboard of the mines, with an empty row above and below the board
+};
+
+#endif // BOARD_H
@@ -0,0 +1,126 @@
+#include "boardview.h"
+#include <QPainter>
+
+// Files of the sprites, in the order of BoardView::Sprite
+static const char *const spriteFiles[BoardView::SpriteCount] = {
+    ":/assets/0.png", ":/assets/1.png", ":/assets/2.png", ":/assets/3.png", ":/assets/4.png",
+    ":/assets/5.png", ":/assets/6.png", ":/assets/7.png", ":/assets/8.png",
+    ":/assets/empty.png", ":/assets/flag.png", ":/assets/hint.png", ":/assets/mine.png"
+};
+
+// Constructor for BoardView, builds the sprite atlas
+BoardView::BoardView(QWidget *parent)
+    : QWidget(parent)
+    , rows(0)
+    , cols(0)
+    , pressedRow(-1)
+    , pressedCol(-1)
+{
+    atlas = QPixmap(cellSize * SpriteCount, cellSize);
+    atlas.fill(Qt::transparent);
+    QPainter painter(&atlas);
+    for (int i = 0; i < SpriteCount; ++i) {
+        painter.drawPixmap(i * cellSize, 0, cellSize, cellSize, QPixmap(spriteFiles[i]));
+    }
+}
+
+// Resize the board, every cell shows the empty sprite
+void BoardView::setBoardSize(int rows, int cols)
+{
+    this->rows = rows;
+    this->cols = cols;
+    sprites.fill(Empty, rows * cols);
+    queued = QRect();
+    pressedRow = -1;
+    setFixedSize(cols * cellSize, rows * cellSize);
+    update();
+}
+
+// Change the sprite of a cell, only that cell is repainted
+void BoardView::setSprite(int row, int col, int sprite)
+{
+    if (sprites[row * cols + col] == sprite) {
+        return;
+    }
+    sprites[row * cols + col] = sprite;
+    update(col * cellSize, row * cellSize, cellSize, cellSize);
+}
+
+// Change the sprite of a cell without repainting it, many cells can be changed and repainted at once with flushSprites
+void BoardView::queueSprite(int row, int col, int sprite)
+{
+    sprites[row * cols + col] = sprite;
+    queued = queued.isNull() ? QRect(col, row, 1, 1) : queued.united(QRect(col, row, 1, 1));
+}
+
+// Repaint the cells changed by queueSprite, as one area that covers all of them
+void BoardView::flushSprites()
+{
+    if (queued.isNull()) {
+        return;
+    }
+    update(queued.left() * cellSize, queued.top() * cellSize, queued.width() * cellSize, queued.height() * cellSize);
+    queued = QRect();
+}
+
+// Get the sprite of a cell
+int BoardView::sprite(int row, int col) const
+{
+    return sprites[row * cols + col];
+}
+
+// Find the cell under a point, returns false if the point is outside the board
+bool BoardView::cellAt(const QPoint &pos, int &row, int &col) const
+{
+    if (pos.x() < 0 || pos.y() < 0) {
+        return false;
+    }
+    row = pos.y() / cellSize;
+    col = pos.x() / cellSize;
+    return row < rows && col < cols;
+}
+
+// Paint the cells that intersect the area that needs repainting
+void BoardView::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    const QRect &area = event->rect();
+    int firstRow = qMax(0, area.top() / cellSize);
+    int lastRow = qMin(rows - 1, area.bottom() / cellSize);
+    int firstCol = qMax(0, area.left() / cellSize);
+    int lastCol = qMin(cols - 1, area.right() / cellSize);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int col = firstCol; col <= lastCol; ++col) {
+            painter.drawPixmap(col * cellSize, row * cellSize, atlas, sprites[row * cols + col] * cellSize, 0, cellSize, cellSize);
+        }
+    }
+}
+
+// Right-clicks are handled when pressed, left-clicks are remembered until released like a button
+void BoardView::mousePressEvent(QMouseEvent *event)
+{
+    int row, col;
+    if (!cellAt(event->pos(), row, col)) {
+        return;
+    }
+    if (event->button() == Qt::RightButton) {
+        emit cellRightClicked(row, col);  // Emit cellRightClicked signal when right button is pressed
+    } else if (event->button() == Qt::LeftButton) {
+        pressedRow = row;
+        pressedCol = col;
+    }
+}
+
+// A left-click is a press and a release on the same cell
+void BoardView::mouseReleaseEvent(QMouseEvent *event)
+{
+    int row, col;
+    if (event->button() != Qt::LeftButton || pressedRow == -1) {
+        return;
+    }
+    bool sameCell = cellAt(event->pos(), row, col) && row == pressedRow && col == pressedCol;
+    pressedRow = -1;
+    if (sameCell) {
+        emit cellClicked(row, col);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef BOARDVIEW_H
+#define BOARDVIEW_H
+
+#include <QWidget>
+#include <QPixmap>
+#include <QVector>
+#include <QMouseEvent>
+#include <QPaintEvent>
+
+// Widget that paints the whole board itself, one sprite per cell, instead of one button per cell
+class BoardView : public QWidget {
+    Q_OBJECT
+public:
+    // Sprites a cell can show, numbers 0-8 are their own sprites
+    enum Sprite { Empty = 9, Flag, Hint, Mine, SpriteCount };
+    static const int cellSize = 15;
+
+    BoardView(QWidget *parent = nullptr);
+    void setBoardSize(int rows, int cols);
+    void setSprite(int row, int col, int sprite);
+    void queueSprite(int row, int col, int sprite);
+    void flushSprites();
+    int sprite(int row, int col) const;
+    bool cellAt(const QPoint &pos, int &row, int &col) const;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+signals:
+    void cellClicked(int row, int col);
+    void cellRightClicked(int row, int col);
+
+private:
+    int rows;
+    int cols;
+    QVector<uchar> sprites; // sprite of each cell, row by row
+    QPixmap atlas; // all sprites side by side, scaled to the cell size once
+    QRect queued; // rows and columns of the cells changed by queueSprite since the last flushSprites
+    int pressedRow; // cell the left button was pressed on, -1 if none
+    int pressedCol;
+};
+
+#endif // BOARDVIEW_H
@@ -0,0 +1,237 @@
+#include "game.h"
+#include <algorithm>
+
+// Write a number in base 36
+static std::string toBase36(std::uint64_t value)
+{
+    const char *digits = "0123456789abcdefghijklmnopqrstuvwxyz";
+    std::string text;
+    do {
+        text.insert(text.begin(), digits[value % 36]);
+        value /= 36;
+    } while (value > 0);
+    return text;
+}
+
+// Read a number in base 36 that is not larger than max, returns false if the text is not such a number
+static bool fromBase36(const std::string &text, std::uint64_t max, std::uint64_t &value)
+{
+    if (text.empty()) {
+        return false;
+    }
+    value = 0;
+    for (char c : text) {
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'z') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'Z') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;  // Not a base 36 digit
+        }
+        if (value > (max - digit) / 36) {
+            return false;  // Too large
+        }
+        value = value * 36 + digit;
+    }
+    return true;
+}
+
+// Write the board ID, rows-cols-mines-startRow-startCol-seed
+std::string BoardId::toString() const
+{
+    return toBase36(rows) + "-" + toBase36(cols) + "-" + toBase36(mines) + "-" + toBase36(startRow) + "-" + toBase36(startCol)
+           + "-" + toBase36(seed);
+}
+
+// Read a board ID, returns false if it is not valid
+bool BoardId::parse(const std::string &text)
+{
+    std::uint64_t fields[6];
+    size_t start = 0;
+    for (int i = 0; i < 6; ++i) {
+        size_t end = i < 5 ? text.find('-', start) : text.size();
+        if (end == std::string::npos) {
+            return false;  // Missing fields
+        }
+        std::uint64_t max = i < 5 ? INT32_MAX : UINT64_MAX;
+        if (!fromBase36(text.substr(start, end - start), max, fields[i])) {
+            return false;
+        }
+        start = end + 1;
+    }
+    BoardId id{int(fields[0]), int(fields[1]), int(fields[2]), int(fields[3]), int(fields[4]), fields[5]};
+    if (id.rows < 1 || id.cols < 1 || std::uint64_t(id.rows) * id.cols > INT32_MAX || id.mines > id.rows * id.cols
+        || id.startRow >= id.rows || id.startCol >= id.cols) {
+        return false;  // Not a board
+    }
+    *this = id;
+    return true;
+}
+
+// Constructor for Game, starts a new game
+Game::Game(int rows, int cols, int mines)
+    : seeds(std::random_device()())
+{
+    newGame(rows, cols, mines);
+}
+
+// Start a new game on a new random board
+void Game::newGame(int rows, int cols, int mines)
+{
+    newGame(rows, cols, mines, seeds());
+}
+
+// Start a new game on the board of a seed, the mines are placed at the first reveal
+void Game::newGame(int rows, int cols, int mines, std::uint64_t seed)
+{
+    board = Board(rows, cols);
+    id = BoardId{rows, cols, mines, -1, -1, seed};
+    minesPlaced = false;
+    state = Playing;
+    revealedCells = 0;
+    cellStates.assign(board.cellCount(), Revealed);  // The border stays revealed
+    for (int row = 0; row < rows; ++row) {
+        std::fill_n(cellStates.begin() + board.index(row, 0), cols, Hidden);
+    }
+    solver.reset(board);
+    nextHint = 0;
+}
+
+// Start a new game on the board of a board ID, the mines are placed at once so revealing the start cell gives the shared game
+void Game::newGame(const BoardId &id)
+{
+    newGame(id.rows, id.cols, id.mines, id.seed);
+    placeMines(id.startRow, id.startCol);
+}
+
+// Place the mines away from the start cell
+void Game::placeMines(int startRow, int startCol)
+{
+    BoardRandom random(id.seed);
+    board.placeMines(id.mines, random, startRow, startCol);  // Place mines and calculate numbers
+    id.startRow = startRow;
+    id.startCol = startCol;
+    minesPlaced = true;
+}
+
+// Get the board of the game
+const Board &Game::getBoard() const
+{
+    return board;
+}
+
+// Get whether the game goes on, is won or is lost
+Game::State Game::getState() const
+{
+    return state;
+}
+
+// Number of revealed cells
+int Game::revealedCount() const
+{
+    return revealedCells;
+}
+
+// Check if a cell is revealed
+bool Game::isRevealed(int row, int col) const
+{
+    return cellStates[board.index(row, col)] & Revealed;
+}
+
+// Check if a cell is flagged
+bool Game::isFlagged(int row, int col) const
+{
+    return cellStates[board.index(row, col)] & Flagged;
+}
+
+// Check if the cell at an index is revealed, the border is always revealed
+bool Game::isRevealedAt(int cell) const
+{
+    return cellStates[cell] & Revealed;
+}
+
+// Check if the board ID is known, it is once the mines are placed
+bool Game::hasBoardId() const
+{
+    return minesPlaced;
+}
+
+// Get the board ID of the game
+BoardId Game::getBoardId() const
+{
+    return id;
+}
+
+// Reveal a cell, and if it has no neighbouring mines, the whole opening around it
+// returns the indices of the cells that were revealed, the game is lost if the cell is a mine and won if all other cells are revealed
+std::vector<int> Game::reveal(int row, int col)
+{
+    std::vector<int> opened;
+    int cell = board.index(row, col);
+    if (state != Playing || cellStates[cell] & Revealed) {
+        return opened;  // Nothing changes after the game ends or on a revealed cell
+    }
+    if (!minesPlaced) {
+        placeMines(row, col);  // The first revealed cell is the start cell
+    }
+    if (board.isMineAt(cell)) {
+        state = Lost;
+        return opened;
+    }
+
+    // the revealed cells are used as the queue of a breadth first search, so large openings do not need deep recursion
+    const int *neighbours = board.neighbours();
+    cellStates[cell] = Revealed;  // Mark the cell as revealed
+    opened.push_back(cell);
+    for (size_t next = 0; next < opened.size(); ++next) {
+        int current = opened[next];
+        if (board.valueAt(current) != 0) {
+            continue;  // Only empty cells open their neighbours
+        }
+        for (int i = 0; i < 8; ++i) {
+            int neighbour = current + neighbours[i];
+            if (!(cellStates[neighbour] & Revealed)) {  // The border is revealed, so the opening stops there
+                cellStates[neighbour] = Revealed;
+                opened.push_back(neighbour);
+            }
+        }
+    }
+    revealedCells += opened.size();
+    solver.reveal(*this, opened);  // Queue the constraints around the revealed cells
+
+    // Check if the game is won
+    if (revealedCells == board.rowCount() * board.colCount() - board.mineCount()) {
+        state = Won;
+    }
+    return opened;
+}
+
+// Flag or unflag a hidden cell, returns false if the cell cannot be flagged
+bool Game::toggleFlag(int row, int col)
+{
+    int cell = board.index(row, col);
+    if (state != Playing || cellStates[cell] & Revealed) {
+        return false;  // Revealed cells cannot be flagged
+    }
+    cellStates[cell] ^= Flagged;  // Toggle flag state
+    return true;
+}
+
+// Find a safe cell for the hint mechanism, returns {-1, -1} if there is none
+// only the constraints changed since the last hint are applied, so this does not depend on the size of the board
+std::pair<int, int> Game::findHint()
+{
+    solver.solve();  // Find the safe cells from the revealed numbers
+    const std::vector<int> &safeCells = solver.safeCells();
+    while (nextHint < safeCells.size() && cellStates[safeCells[nextHint]] & Revealed) {
+        nextHint++;  // Skip the safe cells that were revealed since they were found
+    }
+    if (nextHint == safeCells.size()) {
+        return {-1, -1};  // No safe cell found
+    }
+    int cell = safeCells[nextHint];
+    return {board.rowOf(cell), board.colOf(cell)};
+}
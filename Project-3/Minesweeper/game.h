@@ -0,0 +1,62 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "board.h"
+#include "solver.h"
+#include <vector>
+#include <utility>
+#include <random>
+#include <string>
+
+// Settings that fully determine a board, the mines are placed away from the start cell with the random numbers of the seed
+// written as a board ID, the fields in base 36 separated by dashes, so a board can be shared and played again
+struct BoardId {
+    int rows;
+    int cols;
+    int mines;
+    int startRow; // first revealed cell
+    int startCol;
+    std::uint64_t seed;
+
+    std::string toString() const;
+    bool parse(const std::string &text);
+};
+
+// Rules of a game on a board, the revealed and flagged cells are kept here so a game can be played without widgets
+// cells are passed around as indices of the board array, the border cells are kept revealed so they are never opened or counted
+class Game {
+public:
+    enum State { Playing, Won, Lost };
+    enum CellState : unsigned char { Hidden = 0, Revealed = 1, Flagged = 2 };
+
+    Game(int rows = 10, int cols = 10, int mines = 10);
+    void newGame(int rows, int cols, int mines);
+    void newGame(int rows, int cols, int mines, std::uint64_t seed);
+    void newGame(const BoardId &id);
+    const Board &getBoard() const;
+    State getState() const;
+    int revealedCount() const;
+    bool isRevealed(int row, int col) const;
+    bool isFlagged(int row, int col) const;
+    bool isRevealedAt(int cell) const;
+    bool hasBoardId() const;
+    BoardId getBoardId() const;
+    std::vector<int> reveal(int row, int col);
+    bool toggleFlag(int row, int col);
+    std::pair<int, int> findHint();
+
+private:
+    void placeMines(int startRow, int startCol);
+
+    Board board;
+    bool minesPlaced; // the mines are placed at the first reveal so the first cell is never a mine
+    BoardId id; // settings of the board, the start cell is known once the mines are placed
+    State state;
+    int revealedCells;
+    std::vector<unsigned char> cellStates; // CellState of every cell in the board array, Revealed for the border
+    Solver solver; // finds the hints, it is told about every reveal
+    size_t nextHint; // safe cells of the solver before this one are revealed
+    std::mt19937_64 seeds; // seeds of new games that are not given one
+};
+
+#endif // GAME_H
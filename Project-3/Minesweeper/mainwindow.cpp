@@ -1,11 +1,7 @@
 #include "mainwindow.h"
-#include "flagbutton.h"
-#include <QRandomGenerator>
 #include <QMessageBox>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QSpacerItem>
-#include <QMouseEvent>
 #include <vector>  // Include necessary headers for hint mechanism
 
 // Main window constructor
@@ -14,7 +10,7 @@ MainWindow::MainWindow(QWidget *parent)
     , rows(10)  // Initialize default rows
     , cols(10)  // Initialize default columns
     , mines(10)  // Initialize default mines
-    , revealedCells(0)  // Initialize revealed cells count
+    , game(rows, cols, mines)  // Initialize the game with the default settings
     , lastHint{-1, -1}  // Initialize lastHint to invalid state
 {
     resize(150, 150); // Initial size
@@ -22,21 +18,26 @@ MainWindow::MainWindow(QWidget *parent)
     QWidget *centralWidget = new QWidget(this); // Central widget for the main window
     QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget); // Main vertical layout
 
+    // Make a spin box wide enough for its largest value, with room for the arrows
+    auto fitWidth = [](QSpinBox *input, int largest) {
+        input->setFixedSize(input->fontMetrics().horizontalAdvance(QString::number(largest)) + 30, 25);
+    };
+
     // Add inputs for rows, columns, and mines
     rowsInput = new QSpinBox(this);
-    rowsInput->setRange(5, 50);  // Set range for rows input
+    rowsInput->setRange(5, 1000);  // Set range for rows input
     rowsInput->setValue(rows);  // Set initial value for rows input
-    rowsInput->setFixedSize(40, 25);
+    fitWidth(rowsInput, 1000);
 
     colsInput = new QSpinBox(this);
-    colsInput->setRange(5, 50);  // Set range for columns input
+    colsInput->setRange(5, 1000);  // Set range for columns input
     colsInput->setValue(cols);  // Set initial value for columns input
-    colsInput->setFixedSize(40, 25);
+    fitWidth(colsInput, 1000);
 
     minesInput = new QSpinBox(this);
     minesInput->setRange(1, rows * cols);  // Ensure mines do not exceed cells
     minesInput->setValue(mines);  // Set initial value for mines input
-    minesInput->setFixedSize(40, 25);
+    fitWidth(minesInput, 1000 * 1000);  // The maximum grows with the board up to 1000x1000
 
     QLabel *rowsLabel = new QLabel("Rows:", this);
     rowsLabel->setFixedSize(55, 25);
@@ -70,38 +71,45 @@ MainWindow::MainWindow(QWidget *parent)
     minesLayout->addWidget(minesInput);
     minesLayout->setAlignment(Qt::AlignLeft);
 
+    // Add the board ID input and the button to load it
+    QLabel *boardIdLabel = new QLabel("Board ID:", this);
+    boardIdLabel->setFixedSize(55, 25);
+
+    boardIdInput = new QLineEdit(this);
+    boardIdInput->setPlaceholderText("Shown after the first click");
+    boardIdInput->setFixedSize(200, 25);
+    connect(boardIdInput, &QLineEdit::returnPressed, this, &MainWindow::loadBoardId);
+
+    QPushButton *loadButton = new QPushButton("Load", this);
+    loadButton->setFixedSize(60, 25);
+    connect(loadButton, &QPushButton::clicked, this, &MainWindow::loadBoardId);
+
+    QHBoxLayout *boardIdLayout = new QHBoxLayout(); // Horizontal layout for board ID input
+    boardIdLayout->addWidget(boardIdLabel);
+    boardIdLayout->addWidget(boardIdInput);
+    boardIdLayout->addWidget(loadButton);
+    boardIdLayout->setAlignment(Qt::AlignLeft);
+
     inputLayout->addLayout(rowsLayout);
     inputLayout->addLayout(colsLayout);
     inputLayout->addLayout(minesLayout);
     inputLayout->addWidget(applyButton);
+    inputLayout->addLayout(boardIdLayout);
 
     mainLayout->addLayout(inputLayout);
 
-    // Create a grid layout for the cells
-    gridLayout = new QGridLayout;
-    gridLayout->setSpacing(0);
-    gridLayout->setContentsMargins(0, 0, 0, 0);
+    // Create the board view, it paints all cells itself and is scrolled when it is larger than the window
+    boardView = new BoardView(this);
+    connect(boardView, &BoardView::cellClicked, this, &MainWindow::handleCellClick);
+    connect(boardView, &BoardView::cellRightClicked, this, &MainWindow::handleCellRightClick);
 
-    // Create a widget to hold the grid layout
-    QWidget *gridWidget = new QWidget(this);
-    gridWidget->setLayout(gridLayout);
+    // The scroll area keeps the board centered
+    scrollArea = new QScrollArea(this);
+    scrollArea->setFrameShape(QFrame::NoFrame);
+    scrollArea->setAlignment(Qt::AlignCenter);
+    scrollArea->setWidget(boardView);
 
-    // Add spacers around the grid layout to center it
-    QHBoxLayout *hLayout = new QHBoxLayout();
-    QSpacerItem *hSpacer1 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
-    QSpacerItem *hSpacer2 = new QSpacerItem(40, 20, QSizePolicy::Expanding, QSizePolicy::Minimum);
-    hLayout->addItem(hSpacer1);
-    hLayout->addWidget(gridWidget);
-    hLayout->addItem(hSpacer2);
-
-    QVBoxLayout *vLayout = new QVBoxLayout();
-    QSpacerItem *vSpacer1 = new QSpacerItem(20, 40, QSizePolicy::Minimum, QSizePolicy::Expanding);
-    QSpacerItem *vSpacer2 = new QSpacerItem(20, 40, QSizePolicy::Minimum, QSizePolicy::Expanding);
-    vLayout->addItem(vSpacer1);
-    vLayout->addLayout(hLayout);
-    vLayout->addItem(vSpacer2);
-
-    mainLayout->addLayout(vLayout);
+    mainLayout->addWidget(scrollArea);
 
     setCentralWidget(centralWidget);
 
@@ -130,157 +138,59 @@ MainWindow::~MainWindow()
 // Initialize the game state
 void MainWindow::initializeGame()
 {
-    revealedCells = 0; // Reset revealed cells count
-    scoreLabel->setText("Revealed Cells: 0");
-
-    cells.clear();  // Clear previous cells
-    gameState.clear();  // Clear previous game state
-    certainMines.clear();  // Clear certain mines
-
-    cells.resize(rows);  // Resize cells vector
-    gameState.resize(rows);  // Resize game state vector
-
-    // Clear previous layout items if any
-    QLayoutItem *child;
-    while ((child = gridLayout->takeAt(0)) != nullptr) {
-        delete child->widget();
-        delete child;
-    }
-
-    // Initialize each cell
-    for (int row = 0; row < rows; ++row) {
-        cells[row].resize(cols);
-        gameState[row].resize(cols);
-        for (int col = 0; col < cols; ++col) {
-            cells[row][col] = new FlagButton(this);  // Create new flag button
-            cells[row][col]->setIcon(QIcon(":/assets/empty.png"));  // Set initial icon
-            cells[row][col]->setFixedSize(15, 15);  // Set size
-            cells[row][col]->setIconSize(QSize(15, 15)); // Ensure the icon size is set correctly
-            cells[row][col]->setStyleSheet("QPushButton { border: none; margin: 0px; padding: 0px; }"); // Ensure no margins or padding
-            gridLayout->addWidget(cells[row][col], row, col);
-            connect(cells[row][col], &QPushButton::clicked, this, &MainWindow::handleCellClick);
-            connect(qobject_cast<FlagButton*>(cells[row][col]), &FlagButton::rightClicked, this, &MainWindow::handleCellRightClick);
-        }
-    }
-
-    placeMines();  // Place mines on the grid
-    calculateNumbers();  // Calculate numbers for each cell
-    findMinesRevealed();  // Update certain mines
+    game.newGame(rows, cols, mines);  // Start a new board, its mines are placed at the first click
+    showBoard();
 }
 
-// Place mines randomly on the grid
-void MainWindow::placeMines()
+// Show the hidden board of a new game
+void MainWindow::showBoard()
 {
-    int placedMines = 0;
-    while (placedMines < mines) {
-        int row = QRandomGenerator::global()->bounded(rows);
-        int col = QRandomGenerator::global()->bounded(cols);
-        if (gameState[row][col] == -1) continue;  // Skip if already a mine
-        gameState[row][col] = -1;  // Mark as mine
-        placedMines++;
-    }
-}
+    lastHint = {-1, -1};  // Forget the hint of the previous game
+    scoreLabel->setText("Revealed Cells: 0");
+    boardIdInput->clear();
 
-// Calculate the number of mines surrounding each cell
-void MainWindow::calculateNumbers()
-{
-    for (int row = 0; row < rows; ++row) {
-        for (int col = 0; col < cols; ++col) {
-            if (gameState[row][col] == -1) continue;  // Skip mines
-            int count = 0;
-            for (int i = -1; i <= 1; ++i) {
-                for (int j = -1; j <= 1; ++j) {
-                    int r = row + i;
-                    int c = col + j;
-                    if (r >= 0 && r < rows && c >= 0 && c < cols && gameState[r][c] == -1) {
-                        count++;
-                    }
-                }
-            }
-            gameState[row][col] = count;  // Set mine count
-        }
-    }
+    // Show the hidden board, the scroll area is as large as the board up to a limit
+    boardView->setBoardSize(rows, cols);
+    boardView->setEnabled(true);
+    scrollArea->setMinimumSize(qMin(boardView->width(), 900), qMin(boardView->height(), 600));
 }
 
 // Handle left-click on a cell
-void MainWindow::handleCellClick()
+void MainWindow::handleCellClick(int row, int col)
 {
-    QPushButton *button = qobject_cast<QPushButton *>(sender());
-    int row, col;
-    for (row = 0; row < rows; ++row) {
-        for (col = 0; col < cols; ++col) {
-            if (cells[row][col] == button) {
-                revealCell(row, col);  // Reveal the clicked cell
-                return;
-            }
-        }
-    }
+    revealCell(row, col);  // Reveal the clicked cell
 }
 
 // Handle right-click on a cell
-void MainWindow::handleCellRightClick()
+void MainWindow::handleCellRightClick(int row, int col)
 {
-    FlagButton *button = qobject_cast<FlagButton *>(sender());
-    int row, col;
-    for (row = 0; row < rows; ++row) {
-        for (col = 0; col < cols; ++col) {
-            if (cells[row][col] == button) {
-                if (!button->isFlagged) {
-                    button->setIcon(QIcon(":/assets/flag.png"));  // Set flag icon
-                } else {
-                    button->setIcon(QIcon(":/assets/empty.png"));  // Remove flag icon
-                }
-                button->isFlagged = !button->isFlagged;  // Toggle flag state
-                return;
-            }
-        }
+    if (game.toggleFlag(row, col)) {
+        boardView->setSprite(row, col, game.isFlagged(row, col) ? BoardView::Flag : BoardView::Empty);  // Set or remove flag sprite
     }
 }
 
-// Reveal a cell and handle game logic
+// Reveal a cell and show the result of the game logic
 void MainWindow::revealCell(int row, int col)
 {
-    if (gameState[row][col] == -1) {
-        cells[row][col]->setIcon(QIcon(":/assets/mine.png"));
+    std::vector<int> opened = game.reveal(row, col);
+    if (game.getState() == Game::Lost) {
+        boardView->setSprite(row, col, BoardView::Mine);
         endGame(false);  // End game if mine is revealed
         return;
     }
 
-    QString iconPath = QString(":/assets/%1.png").arg(gameState[row][col]); // Get icon path for cell number
-    cells[row][col]->setIcon(QIcon(iconPath));
-    cells[row][col]->setFixedSize(15, 15);
-    cells[row][col]->setIconSize(QSize(15, 15)); // Ensure the icon size is set correctly
-    cells[row][col]->setStyleSheet("QPushButton { border: none; margin: 0px; padding: 0px; }"); // Ensure no margins or padding
-
-    cells[row][col]->setEnabled(false);  // Disable the revealed cell
-    revealedCells++;
-    scoreLabel->setText("Revealed Cells: " + QString::number(revealedCells));
-
-    if (gameState[row][col] == 0) {
-        revealAdjacentCells(row, col);  // Reveal adjacent cells if empty
+    // Show the numbers of all opened cells with one repaint and update the score once
+    const Board &board = game.getBoard();
+    for (int cell : opened) {
+        boardView->queueSprite(board.rowOf(cell), board.colOf(cell), board.valueAt(cell));
     }
-
-    checkWinCondition();  // Check if the game is won
-}
-
-// Reveal adjacent cells if they are empty
-void MainWindow::revealAdjacentCells(int row, int col)
-{
-    for (int i = -1; i <= 1; ++i) {
-        for (int j = -1; j <= 1; ++j) {
-            int r = row + i;
-            int c = col + j;
-            if (r >= 0 && r < rows && c >= 0 && c < cols && cells[r][c]->isEnabled()) {
-                revealCell(r, c);  // Reveal adjacent cell
-            }
-        }
+    boardView->flushSprites();
+    scoreLabel->setText("Revealed Cells: " + QString::number(game.revealedCount()));
+    if (boardIdInput->text().isEmpty()) {
+        boardIdInput->setText(QString::fromStdString(game.getBoardId().toString()));  // The board is known after the first click
     }
-}
 
-// Check if the game is won
-void MainWindow::checkWinCondition()
-{
-    if (revealedCells == rows * cols - mines) {
+    if (game.getState() == Game::Won) {
         endGame(true);  // End game with win condition
     }
 }
@@ -288,16 +198,17 @@ void MainWindow::checkWinCondition()
 // End the game and show message
 void MainWindow::endGame(bool won)
 {
-    for (int row = 0; row < rows; ++row) {
-        for (int col = 0; col < cols; ++col) {
-            cells[row][col]->setEnabled(false);  // Disable all cells
-            if (gameState[row][col] == -1) {
-                cells[row][col]->setIcon(QIcon(":/assets/mine.png"));
-                cells[row][col]->setIconSize(QSize(15, 15)); // Ensure the icon size is set correctly
-                cells[row][col]->setStyleSheet("QPushButton { border: none; margin: 0px; padding: 0px; }"); // Ensure no margins or padding
+    boardView->setEnabled(false);  // Disable all cells
+    // Show all mines with one repaint
+    const Board &board = game.getBoard();
+    for (int row = 0; row < board.rowCount(); ++row) {
+        for (int col = 0; col < board.colCount(); ++col) {
+            if (board.isMine(row, col)) {
+                boardView->queueSprite(row, col, BoardView::Mine);
             }
         }
     }
+    boardView->flushSprites();
 
     QString message = won ? "You won!" : "You lost!";
     QMessageBox::information(this, "Game Over", message);  // Show game over message
@@ -312,126 +223,48 @@ void MainWindow::restartGame()
 // Apply new settings for rows, columns, and mines
 void MainWindow::applySettings()
 {
-    rows = rowsInput->value();
-    cols = colsInput->value();
-    mines = minesInput->value();
-
-    if (mines > rows * cols) {
+    if (minesInput->value() > rowsInput->value() * colsInput->value()) {
         QMessageBox::warning(this, "Invalid Input", "Number of mines cannot exceed total number of cells.");
         return;
     }
 
-    minesInput->setMaximum(rows * cols);
-
-    // Clear the old grid layout
-    QLayoutItem *child;
-    while ((child = gridLayout->takeAt(0)) != nullptr) {
-        delete child->widget();
-        delete child;
-    }
+    rows = rowsInput->value();
+    cols = colsInput->value();
+    mines = minesInput->value();
 
-    cells.clear();  // Clear previous cells
-    gameState.clear();  // Clear previous game state
-    cells.resize(rows);  // Resize cells vector
-    gameState.resize(rows);  // Resize game state vector
-    for (int row = 0; row < rows; ++row) {
-        cells[row].resize(cols);
-        gameState[row].resize(cols);
-        for (int col = 0; col < cols; ++col) {
-            cells[row][col] = new FlagButton(this);
-            cells[row][col]->setFixedSize(40, 40);
-            cells[row][col]->setIconSize(QSize(40, 40)); // Ensure the icon size is set correctly
-            cells[row][col]->setStyleSheet("QPushButton { border: none; margin: 0px; padding: 0px; }"); // Ensure no margins or padding
-            gridLayout->addWidget(cells[row][col], row, col);
-            connect(cells[row][col], &QPushButton::clicked, this, &MainWindow::handleCellClick);
-            connect(qobject_cast<FlagButton*>(cells[row][col]), &FlagButton::rightClicked, this, &MainWindow::handleCellRightClick);
-        }
-    }
+    minesInput->setMaximum(rows * cols);
 
     initializeGame();  // Initialize the game with new settings
 }
 
-// Find certain mines based on revealed cells
-void MainWindow::findMinesRevealed() {
-    certainMines.clear();  // Clear previous certain mines
-
-    for (int row = 0; row < rows; ++row) {
-        for (int col = 0; col < cols; ++col) {
-            if (gameState[row][col] == -1 || gameState[row][col] == 0) {
-                continue;
-            }
-            std::vector<std::pair<int, int>> unrevealedSquares;
-            int val = gameState[row][col];
-            int count = 0;
-
-            // Check surrounding cells
-            for (int i = -1; i <= 1; ++i) {
-                for (int j = -1; j <= 1; ++j) {
-                    int newRow = row + i;
-                    int newCol = col + j;
-                    if (newRow >= 0 && newRow < rows && newCol >= 0 && newCol < cols) {
-                        if (cells[newRow][newCol]->isEnabled()) {
-                            count++;
-                            unrevealedSquares.push_back({newRow, newCol});
-                        }
-                    }
-                }
-            }
-            // If the number of unrevealed surrounding cells equals the cell's value, mark them as certain mines
-            if (val == count) {
-                for (const auto &cell : unrevealedSquares) {
-                    certainMines.push_back(cell);
-                }
-            }
-        }
+// Load the board of a board ID and reveal its start cell
+void MainWindow::loadBoardId()
+{
+    BoardId id;
+    if (!id.parse(boardIdInput->text().trimmed().toStdString())) {
+        QMessageBox::warning(this, "Invalid Input", "This is not a valid board ID.");
+        return;
     }
-}
-
-// Find a safe cell for the hint mechanism
-std::pair<int, int> MainWindow::findHint() {
-    for (int row = 0; row < rows; ++row) {
-        for (int col = 0; col < cols; ++col) {
-            if (gameState[row][col] > 0 && gameState[row][col] <= 8) {  // Check only numbered cells
-                auto safeCells = findSafeCells(row, col);
-                if (!safeCells.empty()) {
-                    return safeCells.front();  // Return the first safe cell found
-                }
-            }
-        }
+    if (id.rows < 5 || id.rows > 1000 || id.cols < 5 || id.cols > 1000) {
+        QMessageBox::warning(this, "Invalid Input", "Boards must have 5 to 1000 rows and columns.");
+        return;
     }
-    return {-1, -1};  // No safe cell found
-}
 
-// Find safe cells around a given cell
-std::vector<std::pair<int, int>> MainWindow::findSafeCells(int row, int col) {
-    std::vector<std::pair<int, int>> safeCells;
-    int surroundingMines = 0;
-    std::vector<std::pair<int, int>> unrevealedCells;
-    // Check surrounding cells
-    for (int i = -1; i <= 1; ++i) {
-        for (int j = -1; j <= 1; ++j) {
-            int newRow = row + i;
-            int newCol = col + j;
-            if (newRow >= 0 && newRow < rows && newCol >= 0 && newCol < cols) {
-                if (std::find(certainMines.begin(), certainMines.end(), std::make_pair(newRow, newCol)) != certainMines.end()) {
-                    surroundingMines++;
-                } else if (gameState[newRow][newCol] != -1 && cells[newRow][newCol]->isEnabled()) {
-                    unrevealedCells.push_back({newRow, newCol});
-                }
-            }
-        }
-    }
-    // If the number of surrounding mines equals the cell's number, all other unrevealed cells are safe
-    if (surroundingMines == gameState[row][col]) {
-        safeCells = unrevealedCells;
-    }
-    return safeCells;
+    rows = id.rows;
+    cols = id.cols;
+    mines = id.mines;
+    rowsInput->setValue(rows);
+    colsInput->setValue(cols);
+    minesInput->setMaximum(rows * cols);
+    minesInput->setValue(mines);
+
+    game.newGame(id);  // Place the mines of the board
+    showBoard();
+    revealCell(id.startRow, id.startCol);  // Reveal the start cell, as in the shared game
 }
 
 // Show a hint to the player
 void MainWindow::showHint() {
-    findMinesRevealed();  // Update certain mines before providing a hint
-
     if (lastHint.first != -1 && lastHint.second != -1) {
         // Reveal the last hint cell if the hint button is pressed again
         revealCell(lastHint.first, lastHint.second);
@@ -439,10 +272,10 @@ void MainWindow::showHint() {
         return;
     }
 
-    auto hint = findHint();
+    auto hint = game.findHint();
     if (hint.first != -1 && hint.second != -1) {
         // Highlight the hint cell using hint.png asset
-        cells[hint.first][hint.second]->setIcon(QIcon(":/assets/hint.png"));
+        boardView->setSprite(hint.first, hint.second, BoardView::Hint);
         lastHint = hint;  // Store the hint cell
     } else {
         // Show a message that no safe hint is available
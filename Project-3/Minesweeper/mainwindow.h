@@ -5,8 +5,10 @@
 #include <QPushButton>
 #include <QSpinBox>
 #include <QLabel>
-#include <QGridLayout>
-#include "flagbutton.h"
+#include <QLineEdit>
+#include <QScrollArea>
+#include "boardview.h"
+#include "game.h"
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -16,40 +18,34 @@ public:
     ~MainWindow();
 
 private slots:
-    void handleCellClick();
-    void handleCellRightClick();
+    void handleCellClick(int row, int col);
+    void handleCellRightClick(int row, int col);
     void applySettings();
     void restartGame();
+    void loadBoardId();
 
 private:
     void initializeGame();
-    void placeMines();
-    void calculateNumbers();
+    void showBoard();
     void revealCell(int row, int col);
-    void revealAdjacentCells(int row, int col);
-    void checkWinCondition();
     void endGame(bool won);
-    std::pair<int, int> findHint();
-    std::vector<std::pair<int, int>> findSafeCells(int row, int col);
     void showHint();
-    void findMinesRevealed();
 
 
     int rows;
     int cols;
     int mines;
-    int revealedCells;
-    QVector<QVector<FlagButton*>> cells;
-    QVector<QVector<int>> gameState; // -1 for mines, 0-8 for numbers, -2 for flagged cells
-    QGridLayout *gridLayout;
+    Game game; // rules and state of the game, the widgets only show it
+    BoardView *boardView;
+    QScrollArea *scrollArea;
     QLabel *scoreLabel;
     QSpinBox *rowsInput;
     QSpinBox *colsInput;
     QSpinBox *minesInput;
+    QLineEdit *boardIdInput; // shows the ID of the board after the first click, an ID can be pasted and loaded
 
     // Add this member variable
     std::pair<int, int> lastHint;
-    std::vector<std::pair<int, int>> certainMines;
 };
 
 #endif // MAINWINDOW_H
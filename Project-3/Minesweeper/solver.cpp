@@ -0,0 +1,215 @@
+#include "solver.h"
+#include "game.h"
+#include "board.h"
+#include <algorithm>
+#include <bitset>
+
+// Bit of the i-th neighbour in the 3x3 block around a cell, the cell itself is bit 4
+static int neighbourBit(int i)
+{
+    return i < 4 ? i : i + 1;
+}
+
+// Number of set bits
+static int countBits(std::uint64_t bits)
+{
+    return std::bitset<64>(bits).count();
+}
+
+// Move the bits of a 3x3 block to the first 3 rows of a 7x7 frame
+static std::uint64_t spread(std::uint16_t block)
+{
+    return std::uint64_t(block & 7) | std::uint64_t(block >> 3 & 7) << 7 | std::uint64_t(block >> 6 & 7) << 14;
+}
+
+// Where the 3x3 block around the center of the 7x7 frame starts
+static const int centerShift = 2 * 7 + 2;
+
+// Forget everything about the previous game and prepare for a board
+void Solver::reset(const Board &board)
+{
+    stride = board.index(1, 0) - board.index(0, 0);
+    std::copy(board.neighbours(), board.neighbours() + 8, neighbourOffsets);
+    int window = 0;
+    for (int row = -2; row <= 2; ++row) {
+        for (int col = -2; col <= 2; ++col) {
+            if (row == 0 && col == 0) continue;  // Skip the constraint itself
+            windowOffsets[window] = row * stride + col;
+            windowShifts[window] = (2 + row) * 7 + 2 + col;
+            window++;
+        }
+    }
+    for (int i = 0; i < 49; ++i) {
+        frameOffsets[i] = (i / 7 - 3) * stride + i % 7 - 3;
+    }
+
+    constraints.assign(board.cellCount(), Constraint{0, 0, false});
+    safe.assign(board.cellCount(), false);
+    mine.assign(board.cellCount(), false);
+    safeList.clear();
+    mineList.clear();
+    worklist.clear();
+}
+
+// Take in the cells revealed by a click, every revealed number next to hidden cells becomes a constraint
+// only the constraints around the revealed cells are queued, solve() applies them
+void Solver::reveal(const Game &game, const std::vector<int> &opened)
+{
+    const Board &board = game.getBoard();
+    for (int cell : opened) {
+        if (!safe[cell]) {
+            learn(cell, false);  // A revealed cell is safe, it is no longer unknown in the constraints around it
+        }
+        if (board.valueAt(cell) <= 0) {
+            continue;
+        }
+        std::uint16_t unknown = 0;
+        int mines = board.valueAt(cell);
+        for (int i = 0; i < 8; ++i) {
+            int neighbour = cell + neighbourOffsets[i];
+            if (mine[neighbour]) {
+                mines--;  // Already known mines are not part of the constraint
+            } else if (!safe[neighbour] && !game.isRevealedAt(neighbour)) {  // The border is revealed
+                unknown |= 1 << neighbourBit(i);
+            }
+        }
+        if (unknown) {
+            constraints[cell] = Constraint{unknown, static_cast<signed char>(mines), false};
+            queue(cell);
+        }
+    }
+}
+
+// Apply the changed constraints until nothing more can be found
+void Solver::solve()
+{
+    while (!worklist.empty()) {
+        int cell = worklist.back();
+        worklist.pop_back();
+        constraints[cell].queued = false;
+        apply(cell);
+    }
+}
+
+// Check if a cell is certainly safe
+bool Solver::isSafe(int cell) const
+{
+    return safe[cell];
+}
+
+// Check if a cell is certainly a mine
+bool Solver::isMine(int cell) const
+{
+    return mine[cell];
+}
+
+// Get the certainly safe cells, in the order they were found
+const std::vector<int> &Solver::safeCells() const
+{
+    return safeList;
+}
+
+// Get the certain mines, in the order they were found
+const std::vector<int> &Solver::mineCells() const
+{
+    return mineList;
+}
+
+// Add a constraint to the worklist if it is not in it
+void Solver::queue(int cell)
+{
+    if (!constraints[cell].queued) {
+        constraints[cell].queued = true;
+        worklist.push_back(cell);
+    }
+}
+
+// Record that a cell is safe or a mine, and remove it from the constraints around it
+void Solver::learn(int cell, bool isMine)
+{
+    if (isMine) {
+        mine[cell] = true;
+    } else {
+        safe[cell] = true;
+    }
+    for (int i = 0; i < 8; ++i) {
+        Constraint &constraint = constraints[cell + neighbourOffsets[i]];
+        std::uint16_t bit = 1 << neighbourBit(7 - i);  // The cell is the opposite neighbour of its neighbour
+        if (constraint.unknown & bit) {
+            constraint.unknown &= ~bit;
+            constraint.mines -= isMine;
+            queue(cell + neighbourOffsets[i]);
+        }
+    }
+}
+
+// Mark a hidden cell that was found to be safe or a mine
+void Solver::mark(int cell, bool isMine)
+{
+    if (safe[cell] || mine[cell]) {
+        return;  // Already known
+    }
+    (isMine ? mineList : safeList).push_back(cell);
+    learn(cell, isMine);
+}
+
+// Mark the cells of a 7x7 frame around a center
+void Solver::markFrame(int center, std::uint64_t frame, bool isMine)
+{
+    for (int i = 0; frame; ++i, frame >>= 1) {
+        if (frame & 1) {
+            mark(center + frameOffsets[i], isMine);
+        }
+    }
+}
+
+// Find what a constraint tells alone and together with each constraint that shares cells with it
+void Solver::apply(int cell)
+{
+    const Constraint &constraint = constraints[cell];
+    if (!constraint.unknown) {
+        return;
+    }
+    std::uint64_t own = spread(constraint.unknown) << centerShift;
+    if (constraint.mines == 0) {
+        markFrame(cell, own, false);  // All unknown cells are safe
+        return;
+    }
+    if (constraint.mines == countBits(own)) {
+        markFrame(cell, own, true);  // All unknown cells are mines
+        return;
+    }
+
+    for (int w = 0; w < 24 && constraint.unknown; ++w) {
+        int other = cell + windowOffsets[w];
+        if (other < 0 || other >= int(constraints.size()) || !constraints[other].unknown) {
+            continue;
+        }
+        std::uint64_t a = spread(constraint.unknown) << centerShift;
+        std::uint64_t b = spread(constraints[other].unknown) << windowShifts[w];
+        std::uint64_t shared = a & b;
+        if (!shared) {
+            continue;
+        }
+        std::uint64_t onlyA = a & ~b;
+        std::uint64_t onlyB = b & ~a;
+        int minesA = constraint.mines;
+        int minesB = constraints[other].mines;
+        int countA = countBits(onlyA);
+        int countB = countBits(onlyB);
+
+        // The shared cells hold at least low and at most high mines, the rest of the mines of each constraint are in its own cells
+        int low = std::max({0, minesA - countA, minesB - countB});
+        int high = std::min({minesA, minesB, countBits(shared)});
+        if (onlyA && minesA == low) {
+            markFrame(cell, onlyA, false);  // e.g. 1-1: the shared cells hold the mine, so the other cells are safe
+        } else if (onlyA && minesA - high == countA) {
+            markFrame(cell, onlyA, true);  // e.g. 1-2-1: the shared cells cannot hold enough mines, so the other cells are mines
+        }
+        if (onlyB && minesB == low) {
+            markFrame(cell, onlyB, false);
+        } else if (onlyB && minesB - high == countB) {
+            markFrame(cell, onlyB, true);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <vector>
+#include <cstdint>
+
+class Board;
+class Game;
+
+// Finds the hidden cells that are certainly safe or certainly mines from the revealed numbers only
+// every revealed number next to hidden cells is a constraint: its unknown neighbours hold a known number of mines.
+// the unknown neighbours of a constraint are kept as a bitmask of its 3x3 block, and two constraints that share cells are
+// compared as bitsets in a 7x7 frame, which finds the subset and overlap patterns like 1-1 and 1-2-1.
+// a worklist keeps only the constraints that changed, so solving takes time close to linear in the frontier.
+// the solver is kept during a game and only told about the revealed cells, so its work depends on the change, not on the board
+class Solver {
+public:
+    void reset(const Board &board);
+    void reveal(const Game &game, const std::vector<int> &opened);
+    void solve();
+    bool isSafe(int cell) const;
+    bool isMine(int cell) const;
+    const std::vector<int> &safeCells() const;
+    const std::vector<int> &mineCells() const;
+
+private:
+    struct Constraint {
+        std::uint16_t unknown; // bits of the unknown cells in the 3x3 block around the number
+        signed char mines; // mines left in the unknown cells
+        bool queued; // in the worklist
+    };
+
+    void queue(int cell);
+    void learn(int cell, bool isMine);
+    void mark(int cell, bool isMine);
+    void markFrame(int center, std::uint64_t frame, bool isMine);
+    void apply(int cell);
+
+    int stride; // cells in a row of the board array
+    int neighbourOffsets[8];
+    int windowOffsets[24]; // offsets of the constraints that can share cells with a constraint
+    int windowShifts[24]; // where the 3x3 block of such a constraint starts in the 7x7 frame
+    int frameOffsets[49]; // offsets of the cells of the 7x7 frame around a constraint
+    std::vector<Constraint> constraints; // constraint of every cell of the board array, no unknown cells if it is none
+    std::vector<bool> safe;
+    std::vector<bool> mine;
+    std::vector<int> safeList; // safe cells in the order they were found
+    std::vector<int> mineList;
+    std::vector<int> worklist; // constraints that changed since they were last applied
+};
+
+#endif // SOLVER_H